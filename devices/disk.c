@@ -7,6 +7,7 @@
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -80,6 +81,10 @@ struct channel {
 #define CHANNEL_CNT 2
 static struct channel channels[CHANNEL_CNT];
 
+/* Upped by each channel's probe_channel() thread. */
+static struct semaphore probe_done;
+
+static void probe_channel (void *c_);
 static void reset_channel (struct channel *);
 static bool check_device_type (struct disk *);
 static void identify_ata_device (struct disk *);
@@ -101,6 +106,7 @@ void
 disk_init (void) {
 	size_t chan_no;
 
+	sema_init (&probe_done, 0);
 	for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++) {
 		struct channel *c = &channels[chan_no];
 		int dev_no;
@@ -139,14 +145,21 @@ disk_init (void) {
 		/* Register interrupt handler. */
 		intr_register_ext (c->irq, interrupt_handler, c->name);
 
-		/* Reset hardware. */
-		reset_channel (c);
+		/* Reset hardware and find the disks, overlapping the reset
+		   delay with the other channel's. */
+		if (thread_create (c->name, PRI_DEFAULT, probe_channel, c) == TID_ERROR)
+			probe_channel (c);
+	}
+
+	for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
+		sema_down (&probe_done);
 
-		/* Distinguish ATA hard disks from other devices. */
-		if (check_device_type (&c->devices[0]))
-			check_device_type (&c->devices[1]);
+	/* Read hard disk identity information.  Done in order, after
+	   probing, so the messages come out the same on every boot. */
+	for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++) {
+		struct channel *c = &channels[chan_no];
+		int dev_no;
 
-		/* Read hard disk identity information. */
 		for (dev_no = 0; dev_no < 2; dev_no++)
 			if (c->devices[dev_no].is_ata)
 				identify_ata_device (&c->devices[dev_no]);
@@ -311,6 +324,22 @@ reset_channel (struct channel *c) {
 	}
 }
 
+/* Resets channel C_ and finds out which of its devices are ATA
+   disks, then ups probe_done.  disk_init() runs one of these per
+   channel, each in its own thread. */
+static void
+probe_channel (void *c_) {
+	struct channel *c = c_;
+
+	reset_channel (c);
+
+	/* Distinguish ATA hard disks from other devices. */
+	if (check_device_type (&c->devices[0]))
+		check_device_type (&c->devices[1]);
+
+	sema_up (&probe_done);
+}
+
 /* Checks whether device D is an ATA disk and sets D's is_ata
    member appropriately.  If D is device 0 (master), returns true
    if it's possible that a slave (device 1) exists on this
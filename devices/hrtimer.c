@@ -0,0 +1,242 @@
+#include "devices/hrtimer.h"
+#include <debug.h>
+#include <stdio.h>
+#include "devices/lapic.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+/* Sleeps shorter than this spin on the TSC instead of blocking,
+   since blocking and waking a thread costs about as much. */
+#define SPIN_NS 20000
+
+/* TSC cycles per 8254 tick, or 0 before hrtimer_init(). */
+static uint64_t tsc_per_tick;
+
+/* Local APIC timer counts per 8254 tick, or 0 if there is no
+   local APIC. */
+static uint64_t lapic_per_tick;
+
+/* Armed timers, earliest expiry on top. */
+static struct heap timers;
+
+static intr_handler_func hrtimer_interrupt;
+static bool timer_less (const struct heap_elem *, const struct heap_elem *,
+                        void *aux);
+static void run_expired (void);
+static void program_next (void);
+static void wake_thread (struct hrtimer *);
+
+/* Calibrates the TSC, and the local APIC timer if there is one,
+   against one 8254 tick.  Must be called with interrupts on,
+   after the 8254 is ticking. */
+void
+hrtimer_init (void) {
+	int64_t start;
+	uint64_t tsc;
+
+	ASSERT (intr_get_level () == INTR_ON);
+
+	heap_init (&timers, timer_less, NULL);
+	if (lapic_init ())
+		intr_register_ext (LAPIC_TIMER_VEC, hrtimer_interrupt, "LAPIC Timer");
+
+	/* Start both counters on a tick edge and read them on the
+	   next one. */
+	start = timer_ticks ();
+	while (timer_ticks () == start)
+		continue;
+	tsc = rdtsc ();
+	if (lapic_present ())
+		lapic_timer_oneshot (UINT32_MAX);
+
+	start = timer_ticks ();
+	while (timer_ticks () == start)
+		continue;
+	tsc_per_tick = rdtsc () - tsc;
+	if (lapic_present ()) {
+		lapic_per_tick = UINT32_MAX - lapic_timer_count ();
+		lapic_timer_stop ();
+	}
+
+	printf ("hrtimer: %llu TSC cycles/tick, %s\n", tsc_per_tick,
+			lapic_present () ? "local APIC one-shot" : "no local APIC");
+}
+
+/* Returns true once hrtimer_init() has calibrated the TSC. */
+bool
+hrtimer_ready (void) {
+	return tsc_per_tick != 0;
+}
+
+/* Returns the current TSC value, for timing at cycle
+   resolution. */
+uint64_t
+hrtimer_cycles (void) {
+	return rdtsc ();
+}
+
+/* Converts NS nanoseconds into TSC cycles.  Exact for intervals
+   up to a few minutes. */
+uint64_t
+hrtimer_ns_to_cycles (uint64_t ns) {
+	ASSERT (hrtimer_ready ());
+	return ns * tsc_per_tick / (1000 * 1000 * 1000 / TIMER_FREQ);
+}
+
+/* Converts CYCLES TSC cycles into nanoseconds. */
+uint64_t
+hrtimer_cycles_to_ns (uint64_t cycles) {
+	ASSERT (hrtimer_ready ());
+	return cycles / tsc_per_tick * (1000 * 1000 * 1000 / TIMER_FREQ)
+		+ cycles % tsc_per_tick * (1000 * 1000 * 1000 / TIMER_FREQ) / tsc_per_tick;
+}
+
+/* Arms T to call FUNC (T) from the timer interrupt once the TSC
+   reaches EXPIRES.  T must not already be armed. */
+void
+hrtimer_start (struct hrtimer *t, uint64_t expires, hrtimer_func *func,
+               void *aux) {
+	enum intr_level old_level;
+
+	ASSERT (t != NULL);
+	ASSERT (func != NULL);
+
+	old_level = intr_disable ();
+	ASSERT (!t->armed);
+	t->expires = expires;
+	t->func = func;
+	t->aux = aux;
+	t->armed = true;
+	heap_insert (&timers, &t->elem);
+	if (heap_top (&timers) == &t->elem)
+		program_next ();
+	intr_set_level (old_level);
+}
+
+/* Disarms T.  Returns true if T had not fired yet. */
+bool
+hrtimer_cancel (struct hrtimer *t) {
+	enum intr_level old_level;
+	bool armed;
+
+	ASSERT (t != NULL);
+
+	old_level = intr_disable ();
+	armed = t->armed;
+	if (armed) {
+		heap_remove (&timers, &t->elem);
+		t->armed = false;
+		program_next ();
+	}
+	intr_set_level (old_level);
+	return armed;
+}
+
+/* Called by the 8254 timer interrupt.  Without a local APIC this
+   is where timers expire. */
+void
+hrtimer_tick (void) {
+	if (!lapic_present () && !heap_empty (&timers))
+		run_expired ();
+}
+
+/* Sleeps for NS nanoseconds.  Short sleeps spin on the TSC;
+   longer ones block the thread until a timer wakes it.
+   Interrupts must be on. */
+void
+hrtimer_nsleep (uint64_t ns) {
+	uint64_t deadline;
+	struct hrtimer t;
+	enum intr_level old_level;
+
+	ASSERT (intr_get_level () == INTR_ON);
+	ASSERT (!intr_context ());
+
+	deadline = rdtsc () + hrtimer_ns_to_cycles (ns);
+	if (ns < SPIN_NS || !lapic_present ()) {
+		while (rdtsc () < deadline)
+			asm volatile ("pause");
+		return;
+	}
+
+	t.armed = false;
+	old_level = intr_disable ();
+	hrtimer_start (&t, deadline, wake_thread, thread_current ());
+	thread_block ();
+	intr_set_level (old_level);
+}
+
+/* Local APIC timer interrupt handler. */
+static void
+hrtimer_interrupt (struct intr_frame *args UNUSED) {
+	run_expired ();
+}
+
+/* Fires every timer whose expiry has passed, then rearms the
+   local APIC timer for the next one. */
+static void
+run_expired (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (!heap_empty (&timers)) {
+		struct hrtimer *t = heap_entry (heap_top (&timers), struct hrtimer, elem);
+
+		if (t->expires > rdtsc ())
+			break;
+		heap_pop (&timers);
+		t->armed = false;
+		t->func (t);
+	}
+	program_next ();
+}
+
+/* Arms the local APIC timer for the earliest timer, or stops it
+   if none is armed.  A deadline too far away for the 32-bit
+   counter just fires early and is rearmed. */
+static void
+program_next (void) {
+	struct hrtimer *t;
+	uint64_t now, count;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!lapic_present ())
+		return;
+	if (heap_empty (&timers)) {
+		lapic_timer_stop ();
+		return;
+	}
+
+	t = heap_entry (heap_top (&timers), struct hrtimer, elem);
+	now = rdtsc ();
+	if (t->expires <= now)
+		count = 1;
+	else if (t->expires - now >= tsc_per_tick * TIMER_FREQ)
+		count = UINT32_MAX;
+	else
+		count = (t->expires - now) * lapic_per_tick / tsc_per_tick + 1;
+	if (count > UINT32_MAX)
+		count = UINT32_MAX;
+	lapic_timer_oneshot (count);
+}
+
+/* Timer function for hrtimer_nsleep(): wakes the sleeping
+   thread, preempting the current one if the scheduling class
+   says the woken thread should run first. */
+static void
+wake_thread (struct hrtimer *t) {
+	thread_unblock (t->aux);
+	cmp_nowNfirst ();
+}
+
+/* Orders timers so that the earliest expiry is greatest. */
+static bool
+timer_less (const struct heap_elem *a_, const struct heap_elem *b_,
+            void *aux UNUSED) {
+	const struct hrtimer *a = heap_entry (a_, struct hrtimer, elem);
+	const struct hrtimer *b = heap_entry (b_, struct hrtimer, elem);
+
+	return a->expires > b->expires;
+}
@@ -0,0 +1,133 @@
+#include "devices/lapic.h"
+#include <debug.h>
+#include "intrinsic.h"
+#include "threads/init.h"
+#include "threads/mmu.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+
+/* See [IA32-v3a] chapter 10 "Advanced Programmable Interrupt
+   Controller (APIC)" for hardware details.
+
+   Pintos keeps routing device interrupts through the 8259A PICs.
+   The local APIC is used only for its timer, so it is left in
+   "virtual wire" mode, with the PIC's output arriving on LINT0. */
+
+/* IA32_APIC_BASE model-specific register. */
+#define MSR_APIC_BASE 0x1b
+#define APIC_BASE_ENABLE (1 << 11)      /* APIC globally enabled. */
+#define APIC_BASE_ADDR 0xffffff000ULL   /* Physical base address. */
+
+/* Register offsets from the local APIC base. */
+#define LAPIC_EOI 0x0b0                 /* End of interrupt. */
+#define LAPIC_SVR 0x0f0                 /* Spurious interrupt vector. */
+#define LAPIC_LVT_TIMER 0x320           /* Timer local vector table entry. */
+#define LAPIC_LVT_LINT0 0x350           /* LINT0 local vector table entry. */
+#define LAPIC_LVT_LINT1 0x360           /* LINT1 local vector table entry. */
+#define LAPIC_TIMER_INIT 0x380          /* Timer initial count. */
+#define LAPIC_TIMER_CUR 0x390           /* Timer current count. */
+#define LAPIC_TIMER_DIV 0x3e0           /* Timer divide configuration. */
+
+#define SVR_ENABLE 0x100                /* APIC software enable. */
+#define LVT_MASKED 0x10000              /* Interrupt masked. */
+#define LVT_EXTINT 0x700                /* Delivery mode ExtINT. */
+#define LVT_NMI 0x400                   /* Delivery mode NMI. */
+#define TIMER_DIV_16 0x3                /* Count every 16 bus clocks. */
+
+/* Kernel virtual address of the local APIC registers, or null if
+   there is no usable local APIC. */
+static volatile uint32_t *lapic;
+
+static uint32_t
+lapic_read (int reg) {
+	return lapic[reg / 4];
+}
+
+static void
+lapic_write (int reg, uint32_t value) {
+	lapic[reg / 4] = value;
+}
+
+/* Maps and enables the local APIC and sets up its timer in
+   one-shot mode, masked.  Returns false, leaving the machine as
+   it was, if the CPU has no local APIC or the firmware disabled
+   it. */
+bool
+lapic_init (void) {
+	uint32_t eax, ebx, ecx, edx;
+	uint64_t base, phys, *pte;
+	uint32_t svr;
+
+	/* CPUID.01H:EDX[9] reports an on-chip APIC. */
+	asm volatile ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+			: "a" (1));
+	if (!(edx & (1 << 9)))
+		return false;
+
+	base = read_msr (MSR_APIC_BASE);
+	if (!(base & APIC_BASE_ENABLE))
+		return false;
+
+	/* The registers live above RAM, outside the kernel's direct
+	   map, and must not be cached. */
+	phys = base & APIC_BASE_ADDR;
+	pte = pml4e_walk (base_pml4, (uint64_t) ptov (phys), 1);
+	if (pte == NULL)
+		return false;
+	*pte = phys | PTE_P | PTE_W | PTE_PCD | PTE_PWT;
+	lapic = ptov (phys);
+
+	/* If the firmware left the APIC software-disabled, set up
+	   virtual wire mode ourselves before enabling it, so that PIC
+	   interrupts keep arriving. */
+	svr = lapic_read (LAPIC_SVR);
+	if (!(svr & SVR_ENABLE)) {
+		lapic_write (LAPIC_LVT_LINT0, LVT_EXTINT);
+		lapic_write (LAPIC_LVT_LINT1, LVT_NMI);
+	}
+	lapic_write (LAPIC_SVR, SVR_ENABLE | LAPIC_SPURIOUS_VEC);
+
+	lapic_write (LAPIC_TIMER_DIV, TIMER_DIV_16);
+	lapic_write (LAPIC_LVT_TIMER, LVT_MASKED | LAPIC_TIMER_VEC);
+	lapic_write (LAPIC_TIMER_INIT, 0);
+	return true;
+}
+
+/* Returns true if lapic_init() succeeded. */
+bool
+lapic_present (void) {
+	return lapic != NULL;
+}
+
+/* Acknowledges the local APIC interrupt being handled. */
+void
+lapic_eoi (void) {
+	lapic_write (LAPIC_EOI, 0);
+}
+
+/* Arms the timer to interrupt once after COUNT timer counts. */
+void
+lapic_timer_oneshot (uint32_t count) {
+	ASSERT (lapic != NULL);
+
+	lapic_write (LAPIC_LVT_TIMER, LAPIC_TIMER_VEC);
+	lapic_write (LAPIC_TIMER_INIT, count);
+}
+
+/* Disarms the timer. */
+void
+lapic_timer_stop (void) {
+	ASSERT (lapic != NULL);
+
+	lapic_write (LAPIC_LVT_TIMER, LVT_MASKED | LAPIC_TIMER_VEC);
+	lapic_write (LAPIC_TIMER_INIT, 0);
+}
+
+/* Returns the timer's current count, which counts down from the
+   value last armed to 0. */
+uint32_t
+lapic_timer_count (void) {
+	ASSERT (lapic != NULL);
+
+	return lapic_read (LAPIC_TIMER_CUR);
+}
@@ -3,10 +3,12 @@
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
+#include "devices/hrtimer.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -24,48 +26,144 @@ static int64_t ticks;
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* 8254 input frequency. */
+#define PIT_HZ 1193180
+
+/* 8254 counts per timer tick, rounded to nearest. */
+#define PIT_COUNT ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* 16비트 카운터 한 번으로 예약할 수 있는 최대 tick 수. */
+#define ONESHOT_MAX_TICKS (0xffff / PIT_COUNT)
+
+/* If true, stop the periodic tick while the idle thread halts.
+   Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* idle 진입 시 one-shot으로 예약한 tick 수.  0이면 주기 모드. */
+static int64_t oneshot_ticks;
+
 static intr_handler_func timer_interrupt;
-static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
+static void pit_program_periodic (void);
+static void pit_program_oneshot (uint16_t count);
 
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
    interrupt PIT_FREQ times per second, and registers the
    corresponding interrupt. */
 void
 timer_init (void) {
+	pit_program_periodic ();
+	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
+}
+
+/* Programs counter 0 to interrupt TIMER_FREQ times per second. */
+static void
+pit_program_periodic (void) {
 	/* 8254 input frequency divided by TIMER_FREQ, rounded to
 	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
+	uint16_t count = PIT_COUNT;
 
 	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
 	outb (0x40, count & 0xff);
 	outb (0x40, count >> 8);
+}
 
-	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
+/* Programs counter 0 to interrupt once after COUNT input clocks. */
+static void
+pit_program_oneshot (uint16_t count) {
+	outb (0x43, 0x30);    /* CW: counter 0, LSB then MSB, mode 0, binary. */
+	outb (0x40, count & 0xff);
+	outb (0x40, count >> 8);
+}
+
+/* Called by the idle thread, with interrupts off, right before it
+   halts.  In tickless mode, replaces the periodic tick by a single
+   interrupt at the next sleeper's wakeup tick, so that an idle
+   machine is not woken every tick for nothing.  A periodic
+   scheduling class such as MLFQS needs every tick for its own
+   bookkeeping, so it keeps the periodic tick. */
+void
+timer_idle_enter (void) {
+	int64_t next, delta;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!timer_tickless || sched_class->periodic || oneshot_ticks != 0)
+		return;
+
+	next = get_next_tick_to_awake ();
+	if (workqueue_next_expiry () < next)
+		next = workqueue_next_expiry ();
+	delta = next == INT64_MAX ? ONESHOT_MAX_TICKS : next - ticks;
+	if (delta > ONESHOT_MAX_TICKS)
+		delta = ONESHOT_MAX_TICKS;
+
+	/* 다음 tick에 할 일이 있으면 주기 모드를 그대로 쓴다. */
+	if (delta <= 1)
+		return;
+
+	oneshot_ticks = delta;
+	pit_program_oneshot (delta * PIT_COUNT);
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Called by schedule(), with interrupts off, whenever the idle
+   thread gives up the CPU, whether it blocks again or an interrupt
+   that woke it from halt yields to another thread.  If an interrupt
+   other than the timer ended the halt before the one-shot expired,
+   accounts the ticks that went by and returns to periodic mode. */
+void
+timer_idle_exit (void) {
+	uint16_t remain;
+	int64_t elapsed;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (oneshot_ticks == 0)
+		return;
+
+	/* Latch counter 0 and read the remaining count. */
+	outb (0x43, 0x00);
+	remain = inb (0x40);
+	remain |= inb (0x40) << 8;
+
+	/* 카운터가 이미 0을 지나 돌았다면 곧 타이머 인터럽트가 들어와
+	   마지막 tick을 더하므로, 여기서는 그 직전까지만 정산한다. */
+	elapsed = (oneshot_ticks * PIT_COUNT - remain) / PIT_COUNT;
+	if (remain > oneshot_ticks * PIT_COUNT || elapsed >= oneshot_ticks)
+		elapsed = oneshot_ticks - 1;
+
+	oneshot_ticks = 0;
+	pit_program_periodic ();
+	ticks += elapsed;
+	thread_account_idle (elapsed);
+}
+
+/* Calibrates loops_per_tick, used to implement brief delays.
+   Rather than searching for the loop count that fills one tick,
+   which takes dozens of ticks, times a fixed number of loops
+   against the TSC, whose rate hrtimer_init() has measured. */
 void
 timer_calibrate (void) {
-	unsigned high_bit, test_bit;
+	const unsigned probe = 1u << 16;
+	enum intr_level old_level;
+	uint64_t start, cycles;
 
-	ASSERT (intr_get_level () == INTR_ON);
+	ASSERT (hrtimer_ready ());
 	printf ("Calibrating timer...  ");
 
-	/* Approximate loops_per_tick as the largest power-of-two
-	   still less than one timer tick. */
-	loops_per_tick = 1u << 10;
-	while (!too_many_loops (loops_per_tick << 1)) {
-		loops_per_tick <<= 1;
-		ASSERT (loops_per_tick != 0);
-	}
+	/* Run once to warm up, then time a second run with no
+	   interrupts in the way. */
+	old_level = intr_disable ();
+	busy_wait (probe);
+	start = hrtimer_cycles ();
+	busy_wait (probe);
+	cycles = hrtimer_cycles () - start;
+	intr_set_level (old_level);
 
-	/* Refine the next 8 bits of loops_per_tick. */
-	high_bit = loops_per_tick;
-	for (test_bit = high_bit >> 1; test_bit != high_bit >> 10; test_bit >>= 1)
-		if (!too_many_loops (high_bit | test_bit))
-			loops_per_tick |= test_bit;
+	loops_per_tick = hrtimer_ns_to_cycles (1000 * 1000 * 1000 / TIMER_FREQ)
+		* probe / (cycles != 0 ? cycles : 1);
+	ASSERT (loops_per_tick != 0);
 
 	printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
 }
@@ -127,55 +225,31 @@ timer_print_stats (void) {
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED) {
+	/* one-shot이 만료되었다면 idle 동안 건너뛴 tick을 정산하고
+	   주기 모드로 되돌린다. */
+	if (oneshot_ticks != 0) {
+		ticks += oneshot_ticks - 1;
+		thread_account_idle (oneshot_ticks - 1);
+		oneshot_ticks = 0;
+		pit_program_periodic ();
+	}
+
 	/* 틱을 관리한다. */
 	ticks++;
 	thread_tick ();
 
-	// MLFQ 기능
-	if (thread_mlfqs) 
-	{
-		/* 매 타이머 틱마다 현재 실행 중인 스레드의 recent_cpu 값을 1 증가 */
-		mlfqs_increment();
-
-		/* 4틱마다 실행 */
-		if (!(ticks % 4)) 
-		{
-			/* 전체 스레드의 우선순위 재 계산 */
-			mlfqs_recalc_priority();
-
-			/* 100 틱 = 1초 : 1초마다 load_avg 업데이트*/
-			if (!(ticks % TIMER_FREQ)) 
-			{
-				mlfqs_load_avg();
-				/* 모든 스레드의 recent_cpu값 재계산 */
-				mlfqs_recalc_recent_cpu();
-			}
-		}
-    }
-
 	/* Alarm Clock 기능 */
 	if (get_next_tick_to_awake() <= ticks)
 	{
 	thread_awake(ticks);
 	}
-}
-
-/* Returns true if LOOPS iterations waits for more than one timer
-   tick, otherwise false. */
-static bool
-too_many_loops (unsigned loops) {
-	/* Wait for a timer tick. */
-	int64_t start = ticks;
-	while (ticks == start)
-		barrier ();
 
-	/* Run LOOPS loops. */
-	start = ticks;
-	busy_wait (loops);
+	/* local APIC이 없으면 hrtimer도 여기서 만료시킨다. */
+	hrtimer_tick ();
 
-	/* If the tick count changed, we iterated too long. */
-	barrier ();
-	return start != ticks;
+	/* 만료된 delayed work를 큐에 넣는다. */
+	if (workqueue_next_expiry () <= ticks)
+		workqueue_timer (ticks);
 }
 
 /* Iterates through a simple loop LOOPS times, for implementing
@@ -208,10 +282,16 @@ real_time_sleep (int64_t num, int32_t denom) {
 		   timer_sleep() because it will yield the CPU to other
 		   processes. */
 		timer_sleep (ticks);
+	} else if (hrtimer_ready ()) {
+		/* Otherwise, block on a high-resolution timer, which only
+		   spins for very short sleeps.  NUM/DENOM is under a tick
+		   here, so this cannot overflow. */
+		hrtimer_nsleep (num * (1000 * 1000 * 1000 / denom));
 	} else {
-		/* Otherwise, use a busy-wait loop for more accurate
-		   sub-tick timing.  We scale the numerator and denominator
-		   down by 1000 to avoid the possibility of overflow. */
+		/* Before hrtimer_init(), use a busy-wait loop for more
+		   accurate sub-tick timing.  We scale the numerator and
+		   denominator down by 1000 to avoid the possibility of
+		   overflow. */
 		ASSERT (denom % 1000 == 0);
 		busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
 	}
@@ -4,7 +4,8 @@
 #include <list.h>
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 
 /* A directory. */
 struct dir {
@@ -19,6 +20,22 @@ struct dir_entry {
 	bool in_use;                        /* In use or free? */
 };
 
+/* Directory lock.  Lookups and readdir share it; adding and
+ * removing entries takes it exclusively so that checking for a
+ * name and writing its entry are atomic.  File data is protected
+ * separately by each inode's lock. */
+static struct rwlock dir_lock;
+
+/* Cache of struct dir. */
+static struct kmem_cache dir_slab;
+
+/* Initializes the directory module. */
+void
+dir_init (void) {
+	rwlock_init (&dir_lock);
+	kmem_cache_create (&dir_slab, "dir", sizeof (struct dir), NULL);
+}
+
 /* Creates a directory with space for ENTRY_CNT entries in the
  * given SECTOR.  Returns true if successful, false on failure. */
 bool
@@ -30,14 +47,14 @@ dir_create (disk_sector_t sector, size_t entry_cnt) {
  * it takes ownership.  Returns a null pointer on failure. */
 struct dir *
 dir_open (struct inode *inode) {
-	struct dir *dir = calloc (1, sizeof *dir);
+	struct dir *dir = kmem_cache_zalloc (&dir_slab);
 	if (inode != NULL && dir != NULL) {
 		dir->inode = inode;
 		dir->pos = 0;
 		return dir;
 	} else {
 		inode_close (inode);
-		free (dir);
+		kmem_cache_free (&dir_slab, dir);
 		return NULL;
 	}
 }
@@ -61,7 +78,7 @@ void
 dir_close (struct dir *dir) {
 	if (dir != NULL) {
 		inode_close (dir->inode);
-		free (dir);
+		kmem_cache_free (&dir_slab, dir);
 	}
 }
 
@@ -109,10 +126,12 @@ dir_lookup (const struct dir *dir, const char *name,
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
+	rwlock_acquire_read (&dir_lock);
 	if (lookup (dir, name, &e, NULL))
 		*inode = inode_open (e.inode_sector);
 	else
 		*inode = NULL;
+	rwlock_release_read (&dir_lock);
 
 	return *inode != NULL;
 }
@@ -136,6 +155,8 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	if (*name == '\0' || strlen (name) > NAME_MAX)
 		return false;
 
+	rwlock_acquire_write (&dir_lock);
+
 	/* Check that NAME is not in use. */
 	if (lookup (dir, name, NULL, NULL))
 		goto done;
@@ -159,6 +180,7 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
 
 done:
+	rwlock_release_write (&dir_lock);
 	return success;
 }
 
@@ -175,6 +197,8 @@ dir_remove (struct dir *dir, const char *name) {
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
+	rwlock_acquire_write (&dir_lock);
+
 	/* Find directory entry. */
 	if (!lookup (dir, name, &e, &ofs))
 		goto done;
@@ -194,6 +218,7 @@ dir_remove (struct dir *dir, const char *name) {
 	success = true;
 
 done:
+	rwlock_release_write (&dir_lock);
 	inode_close (inode);
 	return success;
 }
@@ -204,13 +229,17 @@ done:
 bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1]) {
 	struct dir_entry e;
+	bool found = false;
 
+	rwlock_acquire_read (&dir_lock);
 	while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) {
 		dir->pos += sizeof e;
 		if (e.in_use) {
 			strlcpy (name, e.name, NAME_MAX + 1);
-			return true;
+			found = true;
+			break;
 		}
 	}
-	return false;
+	rwlock_release_read (&dir_lock);
+	return found;
 }
@@ -1,7 +1,7 @@
 #include "filesys/file.h"
 #include <debug.h>
 #include "filesys/inode.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 
 /* An open file. */
 struct file
@@ -11,13 +11,22 @@ struct file
 	bool deny_write;		 /* Has file_deny_write() been called? */
 };
 
+/* Cache of struct file. */
+static struct kmem_cache file_slab;
+
+/* Initializes the file module. */
+void file_init(void)
+{
+	kmem_cache_create(&file_slab, "file", sizeof(struct file), NULL);
+}
+
 /* Opens a file for the given INODE, of which it takes ownership,
  * and returns the new file.  Returns a null pointer if an
  * allocation fails or if INODE is null. */
 struct file *
 file_open(struct inode *inode)
 {
-	struct file *file = calloc(1, sizeof *file);
+	struct file *file = kmem_cache_zalloc(&file_slab);
 	if (inode != NULL && file != NULL)
 	{
 		file->inode = inode;
@@ -28,7 +37,7 @@ file_open(struct inode *inode)
 	else
 	{
 		inode_close(inode);
-		free(file);
+		kmem_cache_free(&file_slab, file);
 		return NULL;
 	}
 }
@@ -63,7 +72,7 @@ void file_close(struct file *file)
 	{
 		file_allow_write(file);
 		inode_close(file->inode);
-		free(file);
+		kmem_cache_free(&file_slab, file);
 	}
 }
 
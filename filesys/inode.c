@@ -6,6 +6,10 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -33,6 +37,7 @@ struct inode {
 	int open_cnt;                       /* Number of openers. */
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+	struct rwlock rw;                   /* Readers share, writers exclude. */
 	struct inode_disk data;             /* Inode content. */
 };
 
@@ -53,10 +58,30 @@ byte_to_sector (const struct inode *inode, off_t pos) {
  * returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Protects open_inodes and every inode's open_cnt and removed.
+ * The data of each inode is protected by its own rwlock. */
+static struct lock open_inodes_lock;
+
+/* Cache of struct inode.  An in-memory inode is about 600 bytes,
+ * which malloc() would round up to 1 kB. */
+static struct kmem_cache inode_slab;
+
+/* Constructs the inode at INODE_.  Its rwlock is initialized once
+ * here rather than on every open; inodes are freed with it
+ * released. */
+static void
+inode_ctor (void *inode_) {
+	struct inode *inode = inode_;
+
+	rwlock_init (&inode->rw);
+}
+
 /* Initializes the inode module. */
 void
 inode_init (void) {
 	list_init (&open_inodes);
+	lock_init (&open_inodes_lock);
+	kmem_cache_create (&inode_slab, "inode", sizeof (struct inode), inode_ctor);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -104,36 +129,47 @@ inode_open (disk_sector_t sector) {
 	struct list_elem *e;
 	struct inode *inode;
 
+	lock_acquire (&open_inodes_lock);
+
 	/* Check whether this inode is already open. */
 	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
 			e = list_next (e)) {
 		inode = list_entry (e, struct inode, elem);
 		if (inode->sector == sector) {
-			inode_reopen (inode);
+			inode->open_cnt++;
+			lock_release (&open_inodes_lock);
 			return inode; 
 		}
 	}
 
 	/* Allocate memory. */
-	inode = malloc (sizeof *inode);
-	if (inode == NULL)
+	inode = kmem_cache_alloc (&inode_slab);
+	if (inode == NULL) {
+		lock_release (&open_inodes_lock);
 		return NULL;
+	}
 
-	/* Initialize. */
+	/* Initialize.  The lock stays held across the disk read so
+	 * that a concurrent opener of the same sector finds this
+	 * inode fully read. */
 	list_push_front (&open_inodes, &inode->elem);
 	inode->sector = sector;
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
 	disk_read (filesys_disk, inode->sector, &inode->data);
+	lock_release (&open_inodes_lock);
 	return inode;
 }
 
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode) {
-	if (inode != NULL)
+	if (inode != NULL) {
+		lock_acquire (&open_inodes_lock);
 		inode->open_cnt++;
+		lock_release (&open_inodes_lock);
+	}
 	return inode;
 }
 
@@ -148,15 +184,21 @@ inode_get_inumber (const struct inode *inode) {
  * If INODE was also a removed inode, frees its blocks. */
 void
 inode_close (struct inode *inode) {
+	bool last;
+
 	/* Ignore null pointer. */
 	if (inode == NULL)
 		return;
 
-	/* Release resources if this was the last opener. */
-	if (--inode->open_cnt == 0) {
-		/* Remove from inode list and release lock. */
+	lock_acquire (&open_inodes_lock);
+	last = --inode->open_cnt == 0;
+	if (last)
 		list_remove (&inode->elem);
+	lock_release (&open_inodes_lock);
 
+	/* Release resources if this was the last opener.  Nobody else
+	 * can reach INODE any more, so no lock is needed. */
+	if (last) {
 		/* Deallocate blocks if removed. */
 		if (inode->removed) {
 			free_map_release (inode->sector, 1);
@@ -164,7 +206,7 @@ inode_close (struct inode *inode) {
 					bytes_to_sectors (inode->data.length)); 
 		}
 
-		free (inode); 
+		kmem_cache_free (&inode_slab, inode);
 	}
 }
 
@@ -173,17 +215,27 @@ inode_close (struct inode *inode) {
 void
 inode_remove (struct inode *inode) {
 	ASSERT (inode != NULL);
+
+	lock_acquire (&open_inodes_lock);
 	inode->removed = true;
+	lock_release (&open_inodes_lock);
 }
 
-/* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
- * Returns the number of bytes actually read, which may be less
- * than SIZE if an error occurs or end of file is reached. */
-off_t
-inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
-	uint8_t *buffer = buffer_;
+/* inode_read_at() and inode_write_at() move data through a
+ * kernel page: up to XFER_SIZE bytes of data, then one sector of
+ * scratch space for partial sectors.  The caller's buffer is often
+ * in user memory, and touching it may fault into the file system
+ * again, e.g. to load an mmap'd page of the same file, so it is
+ * only touched while INODE->rw is released. */
+#define XFER_SIZE (PGSIZE - DISK_SECTOR_SIZE)
+
+/* Reads up to SIZE bytes of INODE starting at OFFSET into kernel
+ * buffer BUFFER, using SCRATCH for partial sectors.  Returns the
+ * number of bytes read.  INODE->rw must be held. */
+static off_t
+read_sectors (struct inode *inode, uint8_t *buffer, off_t size, off_t offset,
+		uint8_t *scratch) {
 	off_t bytes_read = 0;
-	uint8_t *bounce = NULL;
 
 	while (size > 0) {
 		/* Disk sector to read, starting byte offset within sector. */
@@ -201,18 +253,13 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 			break;
 
 		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-			/* Read full sector directly into caller's buffer. */
+			/* Read full sector directly into BUFFER. */
 			disk_read (filesys_disk, sector_idx, buffer + bytes_read); 
 		} else {
-			/* Read sector into bounce buffer, then partially copy
-			 * into caller's buffer. */
-			if (bounce == NULL) {
-				bounce = malloc (DISK_SECTOR_SIZE);
-				if (bounce == NULL)
-					break;
-			}
-			disk_read (filesys_disk, sector_idx, bounce);
-			memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
+			/* Read sector into scratch, then partially copy into
+			 * BUFFER. */
+			disk_read (filesys_disk, sector_idx, scratch);
+			memcpy (buffer + bytes_read, scratch + sector_ofs, chunk_size);
 		}
 
 		/* Advance. */
@@ -220,25 +267,17 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 		offset += chunk_size;
 		bytes_read += chunk_size;
 	}
-	free (bounce);
-
 	return bytes_read;
 }
 
-/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
- * Returns the number of bytes actually written, which may be
- * less than SIZE if end of file is reached or an error occurs.
- * (Normally a write at end of file would extend the inode, but
- * growth is not yet implemented.) */
-off_t
-inode_write_at (struct inode *inode, const void *buffer_, off_t size,
-		off_t offset) {
-	const uint8_t *buffer = buffer_;
+/* Writes up to SIZE bytes from kernel buffer BUFFER into INODE
+ * starting at OFFSET, using SCRATCH for partial sectors.  Returns
+ * the number of bytes written.  INODE->rw must be held for
+ * writing. */
+static off_t
+write_sectors (struct inode *inode, const uint8_t *buffer, off_t size,
+		off_t offset, uint8_t *scratch) {
 	off_t bytes_written = 0;
-	uint8_t *bounce = NULL;
-
-	if (inode->deny_write_cnt)
-		return 0;
 
 	while (size > 0) {
 		/* Sector to write, starting byte offset within sector. */
@@ -259,22 +298,15 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 			/* Write full sector directly to disk. */
 			disk_write (filesys_disk, sector_idx, buffer + bytes_written); 
 		} else {
-			/* We need a bounce buffer. */
-			if (bounce == NULL) {
-				bounce = malloc (DISK_SECTOR_SIZE);
-				if (bounce == NULL)
-					break;
-			}
-
 			/* If the sector contains data before or after the chunk
 			   we're writing, then we need to read in the sector
 			   first.  Otherwise we start with a sector of all zeros. */
 			if (sector_ofs > 0 || chunk_size < sector_left) 
-				disk_read (filesys_disk, sector_idx, bounce);
+				disk_read (filesys_disk, sector_idx, scratch);
 			else
-				memset (bounce, 0, DISK_SECTOR_SIZE);
-			memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-			disk_write (filesys_disk, sector_idx, bounce); 
+				memset (scratch, 0, DISK_SECTOR_SIZE);
+			memcpy (scratch + sector_ofs, buffer + bytes_written, chunk_size);
+			disk_write (filesys_disk, sector_idx, scratch); 
 		}
 
 		/* Advance. */
@@ -282,7 +314,84 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		offset += chunk_size;
 		bytes_written += chunk_size;
 	}
-	free (bounce);
+	return bytes_written;
+}
+
+/* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
+ * Returns the number of bytes actually read, which may be less
+ * than SIZE if an error occurs or end of file is reached. */
+off_t
+inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
+	uint8_t *buffer = buffer_;
+	off_t bytes_read = 0;
+	uint8_t *xfer;
+
+	xfer = palloc_get_page (0);
+	if (xfer == NULL)
+		return 0;
+
+	while (size > 0) {
+		off_t chunk_size = size < XFER_SIZE ? size : XFER_SIZE;
+
+		rwlock_acquire_read (&inode->rw);
+		chunk_size = read_sectors (inode, xfer, chunk_size, offset,
+				xfer + XFER_SIZE);
+		rwlock_release_read (&inode->rw);
+		if (chunk_size == 0)
+			break;
+		memcpy (buffer + bytes_read, xfer, chunk_size);
+
+		/* Advance. */
+		size -= chunk_size;
+		offset += chunk_size;
+		bytes_read += chunk_size;
+	}
+	palloc_free_page (xfer);
+
+	return bytes_read;
+}
+
+/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
+ * Returns the number of bytes actually written, which may be
+ * less than SIZE if end of file is reached or an error occurs.
+ * (Normally a write at end of file would extend the inode, but
+ * growth is not yet implemented.) */
+off_t
+inode_write_at (struct inode *inode, const void *buffer_, off_t size,
+		off_t offset) {
+	const uint8_t *buffer = buffer_;
+	off_t bytes_written = 0;
+	uint8_t *xfer;
+
+	/* Reject writes to a denied inode, such as a running
+	 * executable, without queueing behind its readers. */
+	if (inode->deny_write_cnt)
+		return 0;
+
+	xfer = palloc_get_page (0);
+	if (xfer == NULL)
+		return 0;
+
+	while (size > 0) {
+		off_t chunk_size = size < XFER_SIZE ? size : XFER_SIZE;
+
+		memcpy (xfer, buffer + bytes_written, chunk_size);
+		rwlock_acquire_write (&inode->rw);
+		if (inode->deny_write_cnt)
+			chunk_size = 0;
+		else
+			chunk_size = write_sectors (inode, xfer, chunk_size, offset,
+					xfer + XFER_SIZE);
+		rwlock_release_write (&inode->rw);
+		if (chunk_size == 0)
+			break;
+
+		/* Advance. */
+		size -= chunk_size;
+		offset += chunk_size;
+		bytes_written += chunk_size;
+	}
+	palloc_free_page (xfer);
 
 	return bytes_written;
 }
@@ -292,8 +401,10 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 	void
 inode_deny_write (struct inode *inode) 
 {
+	rwlock_acquire_write (&inode->rw);
 	inode->deny_write_cnt++;
 	ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+	rwlock_release_write (&inode->rw);
 }
 
 /* Re-enables writes to INODE.
@@ -301,9 +412,11 @@ inode_deny_write (struct inode *inode)
  * inode_deny_write() on the inode, before closing the inode. */
 void
 inode_allow_write (struct inode *inode) {
+	rwlock_acquire_write (&inode->rw);
 	ASSERT (inode->deny_write_cnt > 0);
 	ASSERT (inode->deny_write_cnt <= inode->open_cnt);
 	inode->deny_write_cnt--;
+	rwlock_release_write (&inode->rw);
 }
 
 /* Returns the length, in bytes, of INODE's data. */
@@ -0,0 +1,42 @@
+#ifndef DEVICES_HRTIMER_H
+#define DEVICES_HRTIMER_H
+
+#include <heap.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* High-resolution timers.
+
+   Time is read from the TSC, whose rate is calibrated once
+   against the 8254 at boot.  Timers expire through the local
+   APIC timer in one-shot mode, so a thread can block for a few
+   microseconds instead of spinning until the next 8254 tick.
+   Without a local APIC, timers expire on the next 8254 tick. */
+
+struct hrtimer;
+typedef void hrtimer_func (struct hrtimer *);
+
+/* A timer.  FUNC runs in the timer interrupt handler. */
+struct hrtimer {
+	uint64_t expires;           /* TSC value at which to fire. */
+	hrtimer_func *func;         /* Function to call. */
+	void *aux;                  /* For use by FUNC. */
+	bool armed;                 /* In the timer heap? */
+	struct heap_elem elem;      /* Element in the timer heap. */
+};
+
+void hrtimer_init (void);
+bool hrtimer_ready (void);
+
+uint64_t hrtimer_cycles (void);
+uint64_t hrtimer_ns_to_cycles (uint64_t ns);
+uint64_t hrtimer_cycles_to_ns (uint64_t cycles);
+
+void hrtimer_start (struct hrtimer *, uint64_t expires,
+                    hrtimer_func *, void *aux);
+bool hrtimer_cancel (struct hrtimer *);
+void hrtimer_tick (void);
+
+void hrtimer_nsleep (uint64_t ns);
+
+#endif /* devices/hrtimer.h */
@@ -0,0 +1,21 @@
+#ifndef DEVICES_LAPIC_H
+#define DEVICES_LAPIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Interrupt vectors for local APIC interrupts.  External
+   interrupts from the 8259A PICs use 0x20...0x2f; the local APIC
+   uses 0x30...0x3f. */
+#define LAPIC_TIMER_VEC 0x30    /* Local APIC timer. */
+#define LAPIC_SPURIOUS_VEC 0x3f /* Spurious interrupt, no EOI. */
+
+bool lapic_init (void);
+bool lapic_present (void);
+void lapic_eoi (void);
+
+void lapic_timer_oneshot (uint32_t count);
+void lapic_timer_stop (void);
+uint32_t lapic_timer_count (void);
+
+#endif /* devices/lapic.h */
@@ -0,0 +1,66 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Intrusive max pairing heap.
+ *
+ * Like `struct list', a heap never allocates memory: each
+ * structure that can be in a heap embeds a `struct heap_elem'
+ * member, and heap_entry() converts an element pointer back to
+ * the enclosing structure.  The ordering is given by a
+ * heap_less_func supplied to heap_init(); heap_top() returns an
+ * element that no other element is greater than.
+ *
+ * Insertion and heap_top() are O(1); heap_pop(), heap_remove()
+ * and heap_update() are O(log n) amortized.  An element whose key
+ * changes while it is in a heap must be passed to heap_update()
+ * before the heap is used again.
+ *
+ * Heaps are not synchronized.  Callers must provide their own
+ * locking, usually by disabling interrupts. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem {
+	struct heap_elem *child;    /* First child. */
+	struct heap_elem *next;     /* Next sibling. */
+	struct heap_elem *prev;     /* Previous sibling, or parent if first child. */
+};
+
+/* Compares the value of two heap elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool heap_less_func (const struct heap_elem *a,
+                             const struct heap_elem *b,
+                             void *aux);
+
+/* Heap. */
+struct heap {
+	struct heap_elem *root;     /* Greatest element, or null. */
+	size_t size;                /* Number of elements. */
+	heap_less_func *less;       /* Comparison function. */
+	void *aux;                  /* Auxiliary data for `less'. */
+};
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+   the structure that HEAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)           \
+	((STRUCT *) ((uint8_t *) &(HEAP_ELEM)->child    \
+		- offsetof (STRUCT, MEMBER.child)))
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+
+void heap_insert (struct heap *, struct heap_elem *);
+struct heap_elem *heap_pop (struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+void heap_update (struct heap *, struct heap_elem *);
+
+struct heap_elem *heap_top (const struct heap *);
+size_t heap_size (const struct heap *);
+bool heap_empty (const struct heap *);
+
+#endif /* lib/kernel/heap.h */
@@ -36,6 +36,13 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* User threads. */
+	SYS_THREAD_CREATE,          /* Start a thread in this process. */
+	SYS_THREAD_EXIT,            /* Terminate the calling thread. */
+	SYS_THREAD_JOIN,            /* Wait for a thread to terminate. */
+	SYS_FUTEX_WAIT,             /* Sleep while a futex word is unchanged. */
+	SYS_FUTEX_WAKE,             /* Wake threads sleeping on a futex word. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,46 @@
+#ifndef __LIB_USER_PTHREAD_H
+#define __LIB_USER_PTHREAD_H
+
+#include <debug.h>
+
+/* A small subset of POSIX threads on top of the thread_create,
+   thread_join and futex system calls.  Mutexes and condition
+   variables only enter the kernel when a thread has to sleep or
+   has to wake a sleeper. */
+
+/* Maximum number of threads created with pthread_create() that
+   may exist (running or not yet joined) at once. */
+#define PTHREAD_MAX 16
+
+/* Stack size of each thread created with pthread_create(). */
+#define PTHREAD_STACK_SIZE (16 * 1024)
+
+typedef int pthread_t;
+
+/* 0: unlocked, 1: locked, 2: locked and possibly contended. */
+typedef struct {
+	int state;
+} pthread_mutex_t;
+#define PTHREAD_MUTEX_INITIALIZER { 0 }
+
+/* Incremented on every signal or broadcast. */
+typedef struct {
+	int seq;
+} pthread_cond_t;
+#define PTHREAD_COND_INITIALIZER { 0 }
+
+int pthread_create (pthread_t *, void *(*start) (void *), void *arg);
+int pthread_join (pthread_t, void **retval);
+void pthread_exit (void *retval) NO_RETURN;
+
+int pthread_mutex_init (pthread_mutex_t *);
+int pthread_mutex_lock (pthread_mutex_t *);
+int pthread_mutex_trylock (pthread_mutex_t *);
+int pthread_mutex_unlock (pthread_mutex_t *);
+
+int pthread_cond_init (pthread_cond_t *);
+int pthread_cond_wait (pthread_cond_t *, pthread_mutex_t *);
+int pthread_cond_signal (pthread_cond_t *);
+int pthread_cond_broadcast (pthread_cond_t *);
+
+#endif /* lib/user/pthread.h */
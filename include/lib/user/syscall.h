@@ -50,6 +50,13 @@ bool isdir (int fd);
 int inumber (int fd);
 int symlink (const char* target, const char* linkpath);
 
+/* User threads.  See <pthread.h> for the usual wrappers. */
+int thread_create (void (*entry) (void *), void *arg, void *stack);
+void thread_exit (void) NO_RETURN;
+int thread_join (int tid);
+int futex_wait (int *uaddr, int val);
+int futex_wake (int *uaddr, int cnt);
+
 static inline void* get_phys_addr (void *user_addr) {
 	void* pa;
 	asm volatile ("movq %0, %%rax" ::"r"(user_addr));
@@ -0,0 +1,60 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/synch.h"
+
+/* Object caches.
+
+   A kmem_cache hands out objects of a single type from slabs,
+   pages carved into as many objects of exactly that size as fit.
+   Compared to malloc(), which rounds every request up to a power
+   of two and shares one free list per size class, this wastes
+   less memory and gives each hot type its own lock.
+
+   A cache may have a constructor, which runs once on each object
+   when its slab is created, not on every allocation.  Objects
+   must therefore be freed in their constructed state, e.g. with
+   any lock they contain released.
+
+   Slabs start their objects at a varying offset ("color") so
+   that objects of different slabs do not all compete for the
+   same cache lines.
+
+   Caches are owned by the caller and are never destroyed. */
+
+typedef void kmem_ctor_func (void *obj);
+
+/* An object cache. */
+struct kmem_cache {
+	const char *name;           /* Name (for statistics). */
+	size_t obj_size;            /* Object size, rounded up for alignment. */
+	size_t obj_cnt;             /* Objects per slab. */
+	size_t obj_ofs;             /* Offset of the first object, uncolored. */
+	size_t color_max;           /* Largest color offset. */
+	size_t color_next;          /* Color offset of the next slab. */
+	kmem_ctor_func *ctor;       /* Constructor, or null. */
+
+	struct lock lock;       /* Protects the members below. */
+	struct list partial;        /* Slabs with free and used objects. */
+	struct list full;           /* Slabs with no free objects. */
+	struct list empty;          /* At most one slab with no used objects. */
+	size_t slab_cnt;            /* Number of slabs. */
+	size_t active_cnt;          /* Objects allocated. */
+	size_t active_max;          /* Most objects allocated at once. */
+	uint64_t alloc_cnt;         /* Total allocations. */
+
+	struct list_elem elem;      /* Element in the list of all caches. */
+};
+
+void kmem_init (void);
+void kmem_cache_create (struct kmem_cache *, const char *name, size_t size,
+                        kmem_ctor_func *ctor);
+void *kmem_cache_alloc (struct kmem_cache *);
+void *kmem_cache_zalloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *);
+void kmem_print_stats (void);
+
+#endif /* threads/slab.h */
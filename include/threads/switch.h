@@ -0,0 +1,25 @@
+#ifndef THREADS_SWITCH_H
+#define THREADS_SWITCH_H
+
+#include <stdint.h>
+
+/* Stack frame saved by switch_threads().  Only callee-saved
+   registers are kept; the return address resumes the thread. */
+struct switch_frame {
+	uint64_t r15;
+	uint64_t r14;
+	uint64_t r13;
+	uint64_t r12;
+	uint64_t rbp;
+	uint64_t rbx;
+	void (*rip) (void);
+};
+
+/* Saves the running thread's registers and stack pointer into
+   *CUR_RSP and resumes the thread whose stack pointer is NEXT_RSP. */
+void switch_threads (uint64_t *cur_rsp, uint64_t next_rsp);
+
+/* Entry point of a thread that has never run.  See thread_create(). */
+void switch_entry (void);
+
+#endif /* threads/switch.h */
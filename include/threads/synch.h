@@ -1,13 +1,14 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
 
 /* A counting semaphore. */
 struct semaphore {
 	unsigned value;             /* Current value. */
-	struct list waiters;        /* List of waiting threads. */
+	struct heap waiters;        /* Waiting threads, highest priority on top. */
 };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -20,9 +21,17 @@ void sema_self_test (void);
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	struct heap waiters;        /* 이 락을 기다리는 스레드, 우선순위 max-heap. */
+	struct heap_elem elem;      /* 소유자의 held_locks 힙 원소. */
+	struct lock_stat *stat;     /* Contention counters, null unless profiling. */
+	uint64_t acquired_tsc;      /* TSC when the holder acquired it. */
 };
 
-void lock_init (struct lock *);
+/* lock_init() names a lock after its argument expression, e.g.
+   "&swap_lock".  Locks sharing a name share one set of counters
+   in the contention report. */
+#define lock_init(LOCK) lock_init_named ((LOCK), #LOCK)
+void lock_init_named (struct lock *, const char *name);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
@@ -30,7 +39,7 @@ bool lock_held_by_current_thread (const struct lock *);
 
 /* Condition variable. */
 struct condition {
-	struct list waiters;        /* List of waiting threads. */
+	struct heap waiters;        /* Waiting threads, highest priority on top. */
 };
 
 void cond_init (struct condition *);
@@ -38,6 +47,32 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Reader-writer lock.  Any number of readers or one writer.
+   Writers take LOCK for the whole write, and readers pass through
+   LOCK on the way in, so a waiting writer holds off new readers and
+   everyone queued behind a writer donates priority to it.  A writer
+   waiting for the readers to drain donates its priority to each of
+   them in turn. */
+struct rwlock {
+	struct lock lock;           /* Held by the writer; entry gate for readers. */
+	unsigned readers;           /* Number of threads reading. */
+	struct list reader_list;    /* struct rw_read of each reader. */
+	bool writer_waiting;        /* A writer waits for readers to drain. */
+	struct semaphore drained;   /* Upped by the last reader out. */
+};
+
+#define rwlock_init(RW) rwlock_init_named ((RW), #RW)
+void rwlock_init_named (struct rwlock *, const char *name);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
+
+/* Lock contention profiling ("-lockstat"). */
+extern int lockstat_top;
+void lock_print_stats (void);
+
 /* Optimization barrier.
  *
  * The compiler will not reorder operations across an
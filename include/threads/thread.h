@@ -7,13 +7,30 @@
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #include "filesys/file.h" /* struct file 정의 */
+
+struct child_info;
 #ifdef VM
 #include "vm/vm.h"
 #endif
 
 /* FDT 관련 상수 정의 */
-#define FDT_PAGES 3
-#define FDCOUNT_LIMIT (FDT_PAGES * (1 << 9)) // 페이지당 512개 엔트리
+#define FD_INLINE 16          /* struct thread 안에 바로 두는 엔트리 수 */
+#define FDCOUNT_LIMIT 1536    /* 프로세스당 최대 FD 수 */
+
+/* 한 스레드가 동시에 읽기로 잡을 수 있는 rwlock 수.
+   디렉터리 검색 중 디렉터리 inode를 읽는 것처럼 서로 다른 rwlock을
+   겹쳐 잡는 경우가 있다. */
+#define RW_READ_MAX 4
+
+/* 스레드가 읽기로 잡은 rwlock 하나.  rwlock의 readers 목록에 들어가
+   쓰기를 기다리는 스레드가 읽는 스레드들에게 우선순위를 기부할 수
+   있게 한다. */
+struct rw_read
+{
+    struct rwlock *rw;          /* 잡은 rwlock, 빈 칸이면 NULL */
+    struct thread *thread;      /* 읽는 스레드 */
+    struct list_elem elem;      /* rw->readers 원소 */
+};
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -39,6 +56,11 @@ typedef int tid_t;
 #define RECENT_CPU_DEFAULT 0
 #define LOAD_AVG_DEFAULT 0
 
+/* Stride scheduling. */
+#define TICKETS_MIN 1          /* Fewest tickets a thread can hold. */
+#define TICKETS_MAX 1000       /* Most tickets a thread can hold. */
+#define STRIDE_ONE (1 << 20)   /* Pass advanced per tick by a 1-ticket thread. */
+
 /* A kernel thread or user process.
  *
  * Each thread structure is stored in its own 4 kB page.  The
@@ -63,7 +85,7 @@ typedef int tid_t;
  *           |                                 |
  *           +---------------------------------+
  *           |              magic              |
- *           |            intr_frame           |
+ *           |            switch_rsp           |
  *           |                :                |
  *           |                :                |
  *           |               name              |
@@ -104,47 +126,79 @@ struct thread
     char name[16];             /* Name (for debugging). */
     int priority;              /* Priority. */
     int64_t weakeup_tick;      /* 깨어날 tick */
+    struct thread *sleep_child;   /* sleep 힙: 첫 번째 자식 */
+    struct thread *sleep_sibling; /* sleep 힙: 다음 형제 */
 
     /* Shared between thread.c and synch.c. */
     struct list_elem elem; /* List element. */
+    struct heap_elem wait_elem;  /* semaphore 대기 힙 원소 */
+    struct heap *wait_heap;      /* wait_elem이 들어 있는 힙, 없으면 NULL */
+    struct heap *cond_heap;      /* cond_wait 중인 condition의 대기 힙 */
+    struct heap_elem *cond_elem; /* cond_heap 안의 원소 */
+    uint64_t wait_seq;           /* 같은 우선순위끼리 FIFO를 지키기 위한 순번 */
 
     /* Priority donation. */
     int init_priority;               /* 원래 우선순위 */
-    struct list donations;           /* 기부된 우선순위 리스트 */
-    struct list_elem donations_elem; /* donations 리스트용 elem */
+    struct heap held_locks;          /* 가진 락, 최고 대기자 우선순위 max-heap */
+    struct heap_elem lock_elem;      /* wait_on_lock->waiters 힙 원소 */
     struct lock *wait_on_lock;       /* 기다리는 락 포인터 */
+    struct rw_read rw_reads[RW_READ_MAX]; /* 읽기로 잡은 rwlock들 */
+    int rw_donated;                  /* 읽기를 기다리는 writer가 준 우선순위, 없으면 -1 */
 
     /* MLFQ scheduling fields. */
     int niceness;
     int recent_cpu;
     struct list_elem all_elem; /* all_list 연결 elem */
+    bool mlfqs_dirty;            /* recent_cpu가 바뀌어 우선순위 재계산 대기 중 */
+    struct list_elem dirty_elem; /* mlfqs_dirty_list 연결 elem */
+
+    /* Stride scheduling fields. */
+    int tickets;                 /* CPU 지분, TICKETS_MIN..TICKETS_MAX */
+    int64_t stride;              /* STRIDE_ONE / tickets */
+    int64_t pass;                /* 가상 시간, 작을수록 먼저 실행 */
+    struct heap_elem stride_elem; /* stride run queue 힙 원소 */
+    uint64_t run_ticks;          /* 실행한 tick 수 */
 
-    /* File Descriptor Table (FDT) 관리 */
+    /* File Descriptor Table (FDT) 관리.
+       처음에는 fd_inline을 테이블로 쓰다가 FD_INLINE개를 넘으면
+       process_add_file()이 두 배씩 키운 테이블을 malloc으로 할당한다.
+       fd_map은 사용 중인 슬롯의 비트맵이다. */
     struct file **fd_table; /* 파일 디스크립터 테이블 */
-    int fd_idx;             /* 다음 할당할 FD 번호 */
+    uint64_t *fd_map;       /* 슬롯 사용 비트맵, fd_cap / 64 워드 */
+    int fd_cap;             /* fd_table 엔트리 수 */
+    int fd_idx;             /* 사용 중인 가장 큰 FD + 1 */
+    struct file *fd_inline[FD_INLINE];
+    uint64_t fd_inline_map;
 
 #ifdef USERPROG
     int exit_status;
-    struct list child_list;
-    struct list_elem child_elem;
+    struct list child_list;          /* 자식들의 struct child_info 목록 */
+    struct child_info *child_info;   /* 부모와 함께 가지는 종료 기록, 없으면 NULL */
     struct thread *parent;
     struct file *running;
 
     struct intr_frame parent_if;
     /* Owned by userprog/process.c. */
     uint64_t *pml4; /* 페이지 맵 레벨 4 포인터 */
+
+    /* 유저 스레드.  같은 프로세스의 스레드는 leader의 pml4, spt, FDT를
+       함께 쓴다.  일반 프로세스는 자기 자신이 leader이다. */
+    struct thread *leader;         /* 프로세스의 메인 스레드 */
+    struct list uthread_list;      /* (leader) 아직 join되지 않은 스레드 */
+    struct list_elem uthread_elem; /* uthread_list 연결 elem */
+    bool exiting;                  /* (leader) 프로세스가 종료 중 */
+    struct lock fd_lock;           /* (leader) FDT 보호 */
 #endif
 
 #ifdef VM
     struct supplemental_page_table spt; /* 가상 메모리 테이블 */
     void *rsp;
 #endif
-    struct semaphore wait_sema;
-    struct semaphore fork_sema;
-    struct semaphore exit_sema;
+    struct semaphore wait_sema;   /* (유저 스레드) 종료했음을 join에 알림 */
+    struct semaphore exit_sema;   /* (유저 스레드) join이 끝나면 해제 */
 
     /* Owned by thread.c. */
-    struct intr_frame tf; /* 스위칭 정보 */
+    uint64_t switch_rsp;  /* switch_threads()가 저장한 커널 스택 포인터 */
     unsigned magic;       /* Stack overflow 검출 */
 };
 
@@ -153,10 +207,41 @@ struct thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the stride (proportional-share) scheduler.
+   Controlled by kernel command-line option "-stride". */
+extern bool thread_stride;
+
+struct runqueue;
+
+/* Scheduling class: the policy that orders the run queue and
+   decides when the running thread is preempted.  thread_init()
+   picks one from the kernel command line and it never changes
+   afterward, so hot paths call through this table instead of
+   testing thread_mlfqs.  The run queue operations are called with
+   interrupts off. */
+struct sched_class {
+    const char *name;
+    bool donation;      /* Locks donate priority to their holders. */
+    bool periodic;      /* Needs every timer tick, even while idle. */
+
+    void (*init_thread) (struct thread *, int priority);
+    void (*exit_thread) (struct thread *);
+    void (*set_priority) (struct thread *, int priority);
+
+    void (*enqueue) (struct runqueue *, struct thread *);
+    void (*dequeue) (struct runqueue *, struct thread *);
+    struct thread *(*pick_next) (struct runqueue *);
+    void (*tick) (struct thread *);
+    bool (*yield_check) (struct runqueue *, struct thread *);
+};
+
+extern const struct sched_class *sched_class;
+
 void thread_init(void);
 void thread_start(void);
 
 void thread_tick(void);
+void thread_account_idle(int64_t ticks);
 void thread_print_stats(void);
 
 typedef void thread_func(void *aux);
@@ -181,6 +266,9 @@ void thread_set_nice(int);
 int thread_get_recent_cpu(void);
 int thread_get_load_avg(void);
 
+int thread_get_tickets(void);
+void thread_set_tickets(int);
+
 void do_iret(struct intr_frame *tf);
 
 void thread_sleep(int64_t ticks);
@@ -189,14 +277,16 @@ void update_next_tick_to_awake(int64_t tick);
 int64_t get_next_tick_to_awake(void);
 
 void donation_priority(void);
+void refresh_priority(void);
+void thread_rw_donate (struct thread *, int priority);
+void thread_rw_restore (void);
+void thread_update_priority(struct thread *, int priority);
 
 void cmp_nowNfirst(void);
 bool cmp_priority(const struct list_elem *a,
                   const struct list_elem *b);
-
-/* Priority scheduling functions. */
-void remove_with_lock(struct lock *);
-void refresh_priority(void);
+heap_less_func cmp_waiter_priority;
+heap_less_func cmp_lock_priority;
 
 void mlfqs_priority(struct thread *);
 void mlfqs_recent_cpu(struct thread *);
@@ -0,0 +1,75 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <heap.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Work queues.
+
+   A work item is a function call that some thread wants done,
+   but not by itself: writeback or cleanup that would otherwise
+   block a faulting or syscall thread.  Items are queued on a
+   workqueue and run by a shared pool of kernel worker threads.
+   Each workqueue has a priority; workers always serve the highest
+   priority queue that has pending items, and run each item at
+   its queue's priority.
+
+   A delayed work item is queued by the timer interrupt once its
+   delay has expired.
+
+   Work items are owned by the caller, who must keep them alive
+   until they have run or have been cancelled.  An item may be
+   queued again, including from its own function, once it has
+   started running.  queue_work() and queue_delayed_work() may be
+   called from interrupt handlers. */
+
+struct work;
+typedef void work_func (struct work *);
+
+/* A work item. */
+struct work {
+	struct list_elem elem;      /* Element in a workqueue's pending list. */
+	work_func *func;            /* Function to call. */
+	void *aux;                  /* For use by FUNC. */
+	struct workqueue *wq;       /* Queue it is pending on, or null. */
+};
+
+/* A work item queued after a delay. */
+struct delayed_work {
+	struct work work;           /* The work item itself. */
+	int64_t expires;            /* Timer tick at which to queue WORK. */
+	struct workqueue *wq;       /* Queue to put WORK on, while armed. */
+	struct heap_elem timer_elem; /* Element in the timer heap. */
+};
+
+/* A workqueue. */
+struct workqueue {
+	const char *name;           /* Name (for debugging). */
+	int priority;               /* Priority at which items run. */
+	struct list pending;        /* Items waiting for a worker. */
+	struct list_elem elem;      /* Element in the list of queues. */
+	uint64_t run_cnt;           /* Number of items run. */
+};
+
+/* Queue for work with no particular priority needs. */
+extern struct workqueue system_wq;
+
+void workqueue_init (void);
+void workqueue_create (struct workqueue *, const char *name, int priority);
+void workqueue_print_stats (void);
+
+void work_init (struct work *, work_func *, void *aux);
+bool queue_work (struct workqueue *, struct work *);
+bool cancel_work (struct work *);
+
+void delayed_work_init (struct delayed_work *, work_func *, void *aux);
+bool queue_delayed_work (struct workqueue *, struct delayed_work *,
+                         int64_t ticks);
+bool cancel_delayed_work (struct delayed_work *);
+
+void workqueue_timer (int64_t now);
+int64_t workqueue_next_expiry (void);
+
+#endif /* threads/workqueue.h */
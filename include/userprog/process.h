@@ -1,6 +1,5 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
-#define FDCOUNT_LIMIT 1024
 #include "filesys/file.h"
 #include "threads/thread.h"
 #include <stdbool.h>
@@ -27,7 +26,11 @@ int process_wait(tid_t);
 void process_exit(void);
 void process_activate(struct thread *next);
 void argument_stack(char **argv, int argc, struct intr_frame *if_);
-struct thread *get_child_process(int pid);
+struct thread *process_current(void);
+tid_t process_thread_create(void *entry, void *arg, void *stack);
+int process_thread_join(tid_t tid);
+void process_check_kill(void);
+void process_init_fdt(struct thread *t);
 int process_add_file(struct file *f);
 struct file *process_get_file(int fd);
 int process_close_file(int fd);
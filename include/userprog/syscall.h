@@ -6,5 +6,4 @@ int write(int fd, const void *buffer, unsigned size);
 void halt(void);
 void exit(int status);
 int open(const char *file);
-extern struct lock filesys_lock;
 #endif /* userprog/syscall.h */
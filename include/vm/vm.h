@@ -7,6 +7,8 @@
 #define VM_VM_H
 #include <stdbool.h>
 #include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 #include <hash.h> /* Project 3: Memory Management */
 
 enum vm_type
@@ -103,11 +105,14 @@ struct page_operations
 
 /* 현재 프로세스의 메모리 공간을 나타냅니다.
  * 이 구조체에 대해 특정 설계를 강제하지 않습니다.
- * 모든 설계는 여러분에게 달려 있습니다. */
+ * 모든 설계는 여러분에게 달려 있습니다.
+ * 리더 스레드가 소유하고 같은 프로세스의 스레드가 모두 함께 쓰므로,
+ * pages와 pml4를 바꿀 때는 lock을 잡는다. */
 struct supplemental_page_table
 {
 	/* 25.05.30 고재웅 작성 */
 	struct hash pages;
+	struct lock lock; /* pages와 프로세스의 pml4를 보호 */
 };
 
 #include "threads/thread.h"
@@ -119,6 +124,13 @@ struct page *spt_find_page(struct supplemental_page_table *spt,
 													 void *va);
 bool spt_insert_page(struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page(struct supplemental_page_table *spt, struct page *page);
+bool spt_lock(struct supplemental_page_table *spt);
+void spt_unlock(struct supplemental_page_table *spt, bool locked);
+
+/* struct page, struct frame, struct lazy_load_arg 전용 slab 캐시 */
+extern struct kmem_cache page_slab;
+extern struct kmem_cache frame_slab;
+extern struct kmem_cache lazy_load_slab;
 
 void vm_init(void);
 bool vm_try_handle_fault(struct intr_frame *f, void *addr, bool user,
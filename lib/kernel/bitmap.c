@@ -3,6 +3,8 @@
 #include <limits.h>
 #include <round.h>
 #include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
 #ifdef FILESYS
 #include "filesys/file.h"
@@ -21,12 +23,25 @@ typedef unsigned long elem_type;
 /* Number of bits in an element. */
 #define ELEM_BITS (sizeof (elem_type) * CHAR_BIT)
 
+/* Bitmaps of at least this many elements keep a summary. */
+#define SUMMARY_MIN_ELEMS 16
+
 /* From the outside, a bitmap is an array of bits.  From the
    inside, it's an array of elem_type (defined above) that
-   simulates an array of bits. */
+   simulates an array of bits.
+
+   All searches work on whole elements.  A large bitmap also keeps
+   a second level: bit I of `full' is set when element I has all
+   of its bits set, and bit I of `empty' when it has none, so a
+   search can skip ELEM_BITS elements at a time past stretches
+   that cannot match.  The number of set bits is kept up to date
+   so that counting the whole bitmap is O(1). */
 struct bitmap {
 	size_t bit_cnt;     /* Number of bits. */
 	elem_type *bits;    /* Elements that represent bits. */
+	size_t set_cnt;     /* Number of bits set to true. */
+	elem_type *full;    /* Elements that are all ones, or null. */
+	elem_type *empty;   /* Elements that are all zeros, or null. */
 };
 
 /* Returns the index of the element that contains the bit
@@ -55,6 +70,21 @@ byte_cnt (size_t bit_cnt) {
 	return sizeof (elem_type) * elem_cnt (bit_cnt);
 }
 
+/* Returns the number of elements in each summary level for a
+   bitmap of BIT_CNT bits, or 0 if it is too small for one. */
+static inline size_t
+summary_cnt (size_t bit_cnt) {
+	size_t elems = elem_cnt (bit_cnt);
+	return elems >= SUMMARY_MIN_ELEMS ? elem_cnt (elems) : 0;
+}
+
+/* Returns the number of bytes of storage, beyond struct bitmap,
+   needed for BIT_CNT bits and their summary. */
+static inline size_t
+storage_size (size_t bit_cnt) {
+	return byte_cnt (bit_cnt) + 2 * sizeof (elem_type) * summary_cnt (bit_cnt);
+}
+
 /* Returns a bit mask in which the bits actually used in the last
    element of B's bits are set to 1 and the rest are set to 0. */
 static inline elem_type
@@ -62,7 +92,105 @@ last_mask (const struct bitmap *b) {
 	int last_bits = b->bit_cnt % ELEM_BITS;
 	return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
-
+
+/* Returns a mask of the bits of element IDX of B that are part
+   of the bitmap. */
+static inline elem_type
+valid_mask (const struct bitmap *b, size_t idx) {
+	return idx == elem_cnt (b->bit_cnt) - 1 ? last_mask (b) : (elem_type) -1;
+}
+
+/* Returns element IDX of B with the bits that equal VALUE turned
+   on, leaving off the bits past the end of B. */
+static inline elem_type
+elem_match (const struct bitmap *b, size_t idx, bool value) {
+	elem_type e = value ? b->bits[idx] : ~b->bits[idx];
+	return e & valid_mask (b, idx);
+}
+
+/* Returns a mask of bits OFS through OFS + CNT - 1 of an element.
+   OFS + CNT must not exceed ELEM_BITS, and CNT must be nonzero. */
+static inline elem_type
+range_mask (size_t ofs, size_t cnt) {
+	elem_type mask = cnt == ELEM_BITS ? (elem_type) -1
+		: ((elem_type) 1 << cnt) - 1;
+	return mask << ofs;
+}
+
+/* Returns the number of 1-bits in E.  The kernel does not link
+   against libgcc, so __builtin_popcount is not available. */
+static inline size_t
+count_ones (elem_type e) {
+	e = e - ((e >> 1) & 0x5555555555555555ULL);
+	e = (e & 0x3333333333333333ULL) + ((e >> 2) & 0x3333333333333333ULL);
+	e = (e + (e >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+	return (e * 0x0101010101010101ULL) >> 56;
+}
+
+/* Brings the summary bits for element IDX of B up to date. */
+static inline void
+update_summary (struct bitmap *b, size_t idx) {
+	elem_type e = b->bits[idx];
+	elem_type bit = bit_mask (idx);
+
+	if (b->full == NULL)
+		return;
+	if (e == valid_mask (b, idx))
+		b->full[elem_idx (idx)] |= bit;
+	else
+		b->full[elem_idx (idx)] &= ~bit;
+	if (e == 0)
+		b->empty[elem_idx (idx)] |= bit;
+	else
+		b->empty[elem_idx (idx)] &= ~bit;
+}
+
+/* Stores E in element IDX of B, keeping the count of set bits
+   and the summary in step.  Interrupts must be off. */
+static inline void
+store_elem (struct bitmap *b, size_t idx, elem_type e) {
+	elem_type old = b->bits[idx];
+
+	if (e == old)
+		return;
+	b->bits[idx] = e;
+	b->set_cnt += count_ones (e);
+	b->set_cnt -= count_ones (old);
+	update_summary (b, idx);
+}
+
+/* Recomputes the count of set bits and the summary of B from its
+   bits, which must have no bits set past the end. */
+static void
+rebuild (struct bitmap *b) {
+	size_t cnt = elem_cnt (b->bit_cnt);
+	size_t i;
+
+	b->set_cnt = 0;
+	if (b->full != NULL) {
+		memset (b->full, 0, sizeof (elem_type) * summary_cnt (b->bit_cnt));
+		memset (b->empty, 0, sizeof (elem_type) * summary_cnt (b->bit_cnt));
+	}
+	for (i = 0; i < cnt; i++) {
+		b->set_cnt += count_ones (b->bits[i]);
+		update_summary (b, i);
+	}
+}
+
+/* Lays out B's bits and summary in the storage at BITS, which must
+   be storage_size (BIT_CNT) bytes, and clears all bits. */
+static void
+init_bitmap (struct bitmap *b, size_t bit_cnt, void *bits) {
+	size_t sum_cnt = summary_cnt (bit_cnt);
+
+	b->bit_cnt = bit_cnt;
+	b->bits = bits;
+	b->full = sum_cnt > 0 ? b->bits + elem_cnt (bit_cnt) : NULL;
+	b->empty = sum_cnt > 0 ? b->full + sum_cnt : NULL;
+	memset (b->bits, 0, byte_cnt (bit_cnt));
+	rebuild (b);
+}
+
 /* Creation and destruction. */
 
 /* Initializes B to be a bitmap of BIT_CNT bits
@@ -73,10 +201,9 @@ struct bitmap *
 bitmap_create (size_t bit_cnt) {
 	struct bitmap *b = malloc (sizeof *b);
 	if (b != NULL) {
-		b->bit_cnt = bit_cnt;
-		b->bits = malloc (byte_cnt (bit_cnt));
-		if (b->bits != NULL || bit_cnt == 0) {
-			bitmap_set_all (b, false);
+		void *bits = malloc (storage_size (bit_cnt));
+		if (bits != NULL || bit_cnt == 0) {
+			init_bitmap (b, bit_cnt, bits);
 			return b;
 		}
 		free (b);
@@ -93,9 +220,7 @@ bitmap_create_in_buf (size_t bit_cnt, void *block, size_t block_size UNUSED) {
 
 	ASSERT (block_size >= bitmap_buf_size (bit_cnt));
 
-	b->bit_cnt = bit_cnt;
-	b->bits = (elem_type *) (b + 1);
-	bitmap_set_all (b, false);
+	init_bitmap (b, bit_cnt, b + 1);
 	return b;
 }
 
@@ -103,7 +228,7 @@ bitmap_create_in_buf (size_t bit_cnt, void *block, size_t block_size UNUSED) {
    with BIT_CNT bits (for use with bitmap_create_in_buf()). */
 size_t
 bitmap_buf_size (size_t bit_cnt) {
-	return sizeof (struct bitmap) + byte_cnt (bit_cnt);
+	return sizeof (struct bitmap) + storage_size (bit_cnt);
 }
 
 /* Destroys bitmap B, freeing its storage.
@@ -116,7 +241,7 @@ bitmap_destroy (struct bitmap *b) {
 		free (b);
 	}
 }
-
+
 /* Bitmap size. */
 
 /* Returns the number of bits in B. */
@@ -124,7 +249,7 @@ size_t
 bitmap_size (const struct bitmap *b) {
 	return b->bit_cnt;
 }
-
+
 /* Setting and testing single bits. */
 
 /* Atomically sets the bit numbered IDX in B to VALUE. */
@@ -138,28 +263,28 @@ bitmap_set (struct bitmap *b, size_t idx, bool value) {
 		bitmap_reset (b, idx);
 }
 
-/* Atomically sets the bit numbered BIT_IDX in B to true. */
+/* Atomically sets the bit numbered BIT_IDX in B to true.
+
+   The single-bit operations update the bit count and summary
+   along with the bit, so they are made atomic by turning
+   interrupts off rather than by a locked instruction. */
 void
 bitmap_mark (struct bitmap *b, size_t bit_idx) {
 	size_t idx = elem_idx (bit_idx);
-	elem_type mask = bit_mask (bit_idx);
+	enum intr_level old_level = intr_disable ();
 
-	/* This is equivalent to `b->bits[idx] |= mask' except that it
-	   is guaranteed to be atomic on a uniprocessor machine.  See
-	   the description of the OR instruction in [IA32-v2b]. */
-	asm ("lock orq %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+	store_elem (b, idx, b->bits[idx] | bit_mask (bit_idx));
+	intr_set_level (old_level);
 }
 
 /* Atomically sets the bit numbered BIT_IDX in B to false. */
 void
 bitmap_reset (struct bitmap *b, size_t bit_idx) {
 	size_t idx = elem_idx (bit_idx);
-	elem_type mask = bit_mask (bit_idx);
+	enum intr_level old_level = intr_disable ();
 
-	/* This is equivalent to `b->bits[idx] &= ~mask' except that it
-	   is guaranteed to be atomic on a uniprocessor machine.  See
-	   the description of the AND instruction in [IA32-v2a]. */
-	asm ("lock andq %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+	store_elem (b, idx, b->bits[idx] & ~bit_mask (bit_idx));
+	intr_set_level (old_level);
 }
 
 /* Atomically toggles the bit numbered IDX in B;
@@ -168,12 +293,10 @@ bitmap_reset (struct bitmap *b, size_t bit_idx) {
 void
 bitmap_flip (struct bitmap *b, size_t bit_idx) {
 	size_t idx = elem_idx (bit_idx);
-	elem_type mask = bit_mask (bit_idx);
+	enum intr_level old_level = intr_disable ();
 
-	/* This is equivalent to `b->bits[idx] ^= mask' except that it
-	   is guaranteed to be atomic on a uniprocessor machine.  See
-	   the description of the XOR instruction in [IA32-v2b]. */
-	asm ("lock xorq %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+	store_elem (b, idx, b->bits[idx] ^ bit_mask (bit_idx));
+	intr_set_level (old_level);
 }
 
 /* Returns the value of the bit numbered IDX in B. */
@@ -183,7 +306,7 @@ bitmap_test (const struct bitmap *b, size_t idx) {
 	ASSERT (idx < b->bit_cnt);
 	return (b->bits[elem_idx (idx)] & bit_mask (idx)) != 0;
 }
-
+
 /* Setting and testing multiple bits. */
 
 /* Sets all bits in B to VALUE. */
@@ -194,50 +317,114 @@ bitmap_set_all (struct bitmap *b, bool value) {
 	bitmap_set_multiple (b, 0, bitmap_size (b), value);
 }
 
-/* Sets the CNT bits starting at START in B to VALUE. */
+/* Sets the CNT bits starting at START in B to VALUE.  Atomic
+   with respect to the other bitmap operations. */
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i;
+	enum intr_level old_level;
 
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		bitmap_set (b, start + i, value);
+	old_level = intr_disable ();
+	while (cnt > 0) {
+		size_t idx = elem_idx (start);
+		size_t ofs = start % ELEM_BITS;
+		size_t n = cnt < ELEM_BITS - ofs ? cnt : ELEM_BITS - ofs;
+		elem_type mask = range_mask (ofs, n);
+
+		store_elem (b, idx, value ? b->bits[idx] | mask : b->bits[idx] & ~mask);
+		start += n;
+		cnt -= n;
+	}
+	intr_set_level (old_level);
 }
 
 /* Returns the number of bits in B between START and START + CNT,
-   exclusive, that are set to VALUE. */
+   exclusive, that are set to VALUE.  Counting the whole bitmap
+   takes constant time. */
 size_t
 bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i, value_cnt;
+	size_t set_cnt, i, left;
 
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	value_cnt = 0;
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
-			value_cnt++;
-	return value_cnt;
+	if (start == 0 && cnt == b->bit_cnt)
+		set_cnt = b->set_cnt;
+	else {
+		set_cnt = 0;
+		for (i = start, left = cnt; left > 0; ) {
+			size_t ofs = i % ELEM_BITS;
+			size_t n = left < ELEM_BITS - ofs ? left : ELEM_BITS - ofs;
+
+			set_cnt += count_ones (b->bits[elem_idx (i)]
+					& range_mask (ofs, n));
+			i += n;
+			left -= n;
+		}
+	}
+	return value ? set_cnt : cnt - set_cnt;
+}
+
+/* Returns the index of the first element at or after IDX in B
+   that may hold a bit set to VALUE, skipping elements the summary
+   shows cannot, or elem_cnt (B's size) if there is none. */
+static size_t
+next_candidate (const struct bitmap *b, size_t idx, bool value) {
+	size_t cnt = elem_cnt (b->bit_cnt);
+	const elem_type *skip;
+	size_t sum_idx, sum_cnt;
+	elem_type e;
+
+	if (b->full == NULL || idx >= cnt)
+		return idx < cnt ? idx : cnt;
+
+	skip = value ? b->empty : b->full;
+	sum_idx = elem_idx (idx);
+	sum_cnt = summary_cnt (b->bit_cnt);
+	e = ~skip[sum_idx] & ((elem_type) -1 << (idx % ELEM_BITS));
+	while (e == 0) {
+		if (++sum_idx >= sum_cnt)
+			return cnt;
+		e = ~skip[sum_idx];
+	}
+	idx = sum_idx * ELEM_BITS + __builtin_ctzl (e);
+	return idx < cnt ? idx : cnt;
+}
+
+/* Returns the index of the first bit in B at or after START, and
+   before END, that is set to VALUE, or END if there is none. */
+static size_t
+find_next (const struct bitmap *b, size_t start, size_t end, bool value) {
+	size_t idx, bit;
+	elem_type e;
+
+	if (start >= end)
+		return end;
+	idx = elem_idx (start);
+	e = elem_match (b, idx, value) & ((elem_type) -1 << (start % ELEM_BITS));
+	while (e == 0) {
+		idx = next_candidate (b, idx + 1, value);
+		if (idx * ELEM_BITS >= end)
+			return end;
+		e = elem_match (b, idx, value);
+	}
+	bit = idx * ELEM_BITS + __builtin_ctzl (e);
+	return bit < end ? bit : end;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
    exclusive, are set to VALUE, and false otherwise. */
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i;
-
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
-			return true;
-	return false;
+	return find_next (b, start, start + cnt, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -260,24 +447,39 @@ bool
 bitmap_all (const struct bitmap *b, size_t start, size_t cnt) {
 	return !bitmap_contains (b, start, cnt, false);
 }
-
+
 /* Finding set or unset bits. */
 
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
-   If there is no such group, returns BITMAP_ERROR. */
+   If there is no such group, returns BITMAP_ERROR.
+
+   Jumps from the start of each run of VALUE bits to its end, so
+   the cost is in the number of runs and elements crossed, not in
+   the number of bits times CNT. */
 size_t
 bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) {
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 
+	if (cnt == 0)
+		return start;
 	if (cnt <= b->bit_cnt) {
 		size_t last = b->bit_cnt - cnt;
-		size_t i;
-		for (i = start; i <= last; i++)
-			if (!bitmap_contains (b, i, cnt, !value))
+		size_t i = start;
+
+		while (i <= last) {
+			size_t run_end;
+
+			i = find_next (b, i, last + 1, value);
+			if (i > last)
+				break;
+			run_end = find_next (b, i, i + cnt, !value);
+			if (run_end == i + cnt)
 				return i;
+			i = run_end;
+		}
 	}
 	return BITMAP_ERROR;
 }
@@ -296,7 +498,7 @@ bitmap_scan_and_flip (struct bitmap *b, size_t start, size_t cnt, bool value) {
 		bitmap_set_multiple (b, idx, cnt, !value);
 	return idx;
 }
-
+
 /* File input and output. */
 
 #ifdef FILESYS
@@ -315,6 +517,7 @@ bitmap_read (struct bitmap *b, struct file *file) {
 		off_t size = byte_cnt (b->bit_cnt);
 		success = file_read_at (file, b->bits, size, 0) == size;
 		b->bits[elem_cnt (b->bit_cnt) - 1] &= last_mask (b);
+		rebuild (b);
 	}
 	return success;
 }
@@ -0,0 +1,167 @@
+#include "heap.h"
+#include "../debug.h"
+
+/* A pairing heap is a heap-ordered multiway tree.  Each node
+   points to its first child, and the children of a node form a
+   doubly linked sibling list.  The `prev' link of a first child
+   points to its parent instead of a sibling, which is what lets
+   heap_remove() unlink an arbitrary node in O(1) before merging
+   its subtrees back in.
+
+   The root's `next' and `prev' links are always null. */
+
+/* Links two heap-ordered trees A and B, either of which may be
+   null, and returns the root of the result.  A and B must not
+   have siblings.  On a tie A stays on top. */
+static struct heap_elem *
+link (struct heap *heap, struct heap_elem *a, struct heap_elem *b) {
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+
+	if (heap->less (a, b, heap->aux)) {
+		struct heap_elem *t = a;
+		a = b;
+		b = t;
+	}
+
+	b->next = a->child;
+	if (a->child != NULL)
+		a->child->prev = b;
+	b->prev = a;
+	a->child = b;
+	return a;
+}
+
+/* Merges the sibling list starting at FIRST into a single tree
+   with the standard two-pass scheme: link neighbours left to
+   right, then fold the pairs together right to left.  Returns
+   the new root, or null if FIRST is null. */
+static struct heap_elem *
+merge_pairs (struct heap *heap, struct heap_elem *first) {
+	struct heap_elem *pairs = NULL;
+	struct heap_elem *root = NULL;
+
+	while (first != NULL) {
+		struct heap_elem *a = first;
+		struct heap_elem *b = a->next;
+
+		first = b != NULL ? b->next : NULL;
+		a->next = a->prev = NULL;
+		if (b != NULL)
+			b->next = b->prev = NULL;
+
+		a = link (heap, a, b);
+		a->next = pairs;
+		pairs = a;
+	}
+
+	while (pairs != NULL) {
+		struct heap_elem *next = pairs->next;
+
+		pairs->next = NULL;
+		root = link (heap, root, pairs);
+		pairs = next;
+	}
+	return root;
+}
+
+/* Initializes HEAP as an empty heap ordered by LESS given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *heap, heap_less_func *less, void *aux) {
+	ASSERT (heap != NULL);
+	ASSERT (less != NULL);
+
+	heap->root = NULL;
+	heap->size = 0;
+	heap->less = less;
+	heap->aux = aux;
+}
+
+/* Inserts ELEM into HEAP. */
+void
+heap_insert (struct heap *heap, struct heap_elem *elem) {
+	ASSERT (heap != NULL);
+	ASSERT (elem != NULL);
+
+	elem->child = elem->next = elem->prev = NULL;
+	heap->root = link (heap, heap->root, elem);
+	heap->size++;
+}
+
+/* Removes and returns the greatest element of HEAP, which must
+   not be empty. */
+struct heap_elem *
+heap_pop (struct heap *heap) {
+	struct heap_elem *root;
+
+	ASSERT (!heap_empty (heap));
+
+	root = heap->root;
+	heap->root = merge_pairs (heap, root->child);
+	root->child = NULL;
+	heap->size--;
+	return root;
+}
+
+/* Removes ELEM, which must be in HEAP, from HEAP. */
+void
+heap_remove (struct heap *heap, struct heap_elem *elem) {
+	struct heap_elem *sub;
+
+	ASSERT (!heap_empty (heap));
+	ASSERT (elem != NULL);
+
+	if (elem == heap->root) {
+		heap_pop (heap);
+		return;
+	}
+
+	if (elem->prev->child == elem)
+		elem->prev->child = elem->next;
+	else
+		elem->prev->next = elem->next;
+	if (elem->next != NULL)
+		elem->next->prev = elem->prev;
+	elem->next = elem->prev = NULL;
+
+	sub = merge_pairs (heap, elem->child);
+	elem->child = NULL;
+	heap->root = link (heap, heap->root, sub);
+	heap->size--;
+}
+
+/* Restores the heap property after ELEM's key changed, in
+   either direction.  ELEM must be in HEAP. */
+void
+heap_update (struct heap *heap, struct heap_elem *elem) {
+	heap_remove (heap, elem);
+	heap_insert (heap, elem);
+}
+
+/* Returns the greatest element of HEAP, or a null pointer if
+   HEAP is empty. */
+struct heap_elem *
+heap_top (const struct heap *heap) {
+	ASSERT (heap != NULL);
+
+	return heap->root;
+}
+
+/* Returns the number of elements in HEAP. */
+size_t
+heap_size (const struct heap *heap) {
+	ASSERT (heap != NULL);
+
+	return heap->size;
+}
+
+/* Returns true if HEAP is empty, false otherwise. */
+bool
+heap_empty (const struct heap *heap) {
+	ASSERT (heap != NULL);
+
+	return heap->root == NULL;
+}
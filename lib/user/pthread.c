@@ -0,0 +1,189 @@
+#include <pthread.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <syscall.h>
+
+/* Bookkeeping for one thread created by pthread_create(). */
+struct pthread_slot {
+	bool used;                      /* In use until joined. */
+	int tid;                        /* Kernel thread id. */
+	void *(*start) (void *);        /* Start routine. */
+	void *arg;                      /* Its argument. */
+	void *retval;                   /* Its return value. */
+};
+
+static struct pthread_slot slots[PTHREAD_MAX];
+static pthread_mutex_t slots_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Stacks for the slots above.  They live in .bss, so the kernel
+   only backs the pages a thread actually touches. */
+static uint8_t stacks[PTHREAD_MAX][PTHREAD_STACK_SIZE]
+	__attribute__ ((aligned (16)));
+
+/* Returns the slot of the running thread, found from the stack
+   pointer, or a null pointer for the main thread. */
+static struct pthread_slot *
+current_slot (void) {
+	uintptr_t rsp = (uintptr_t) __builtin_frame_address (0);
+	uintptr_t base = (uintptr_t) stacks;
+
+	if (rsp < base || rsp >= base + sizeof stacks)
+		return NULL;
+	return &slots[(rsp - base) / PTHREAD_STACK_SIZE];
+}
+
+/* First user-mode function of every pthread. */
+static void
+start_thread (void *slot_) {
+	struct pthread_slot *slot = slot_;
+
+	pthread_exit (slot->start (slot->arg));
+}
+
+/* Starts a thread running START (ARG) and stores its id in
+   *THREAD.  Returns 0 on success, -1 on failure. */
+int
+pthread_create (pthread_t *thread, void *(*start) (void *), void *arg) {
+	int i;
+
+	pthread_mutex_lock (&slots_lock);
+	for (i = 0; i < PTHREAD_MAX; i++)
+		if (!slots[i].used)
+			break;
+	if (i == PTHREAD_MAX) {
+		pthread_mutex_unlock (&slots_lock);
+		return -1;
+	}
+	slots[i].used = true;
+	slots[i].start = start;
+	slots[i].arg = arg;
+	slots[i].retval = NULL;
+	pthread_mutex_unlock (&slots_lock);
+
+	slots[i].tid = thread_create (start_thread, &slots[i],
+	                              stacks[i] + PTHREAD_STACK_SIZE);
+	if (slots[i].tid < 0) {
+		slots[i].used = false;
+		return -1;
+	}
+	*thread = i;
+	return 0;
+}
+
+/* Waits for THREAD to terminate and stores its return value in
+   *RETVAL if RETVAL is not null.  Returns 0 on success, -1 if
+   THREAD is not joinable. */
+int
+pthread_join (pthread_t thread, void **retval) {
+	struct pthread_slot *slot;
+
+	if (thread < 0 || thread >= PTHREAD_MAX || !slots[thread].used)
+		return -1;
+	slot = &slots[thread];
+	if (thread_join (slot->tid) < 0)
+		return -1;
+
+	if (retval != NULL)
+		*retval = slot->retval;
+	pthread_mutex_lock (&slots_lock);
+	slot->used = false;
+	pthread_mutex_unlock (&slots_lock);
+	return 0;
+}
+
+/* Terminates the calling thread with return value RETVAL.  In the
+   main thread this ends the process with status 0. */
+void
+pthread_exit (void *retval) {
+	struct pthread_slot *slot = current_slot ();
+
+	if (slot != NULL)
+		slot->retval = retval;
+	thread_exit ();
+}
+
+int
+pthread_mutex_init (pthread_mutex_t *m) {
+	m->state = 0;
+	return 0;
+}
+
+/* Acquires M.  The fast path is a single compare-and-swap; only
+   a thread that finds M held marks it contended and sleeps in the
+   kernel.  See Drepper, "Futexes Are Tricky", mutex #2. */
+int
+pthread_mutex_lock (pthread_mutex_t *m) {
+	int c = 0;
+
+	if (__atomic_compare_exchange_n (&m->state, &c, 1, false,
+	                                 __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		return 0;
+
+	if (c != 2)
+		c = __atomic_exchange_n (&m->state, 2, __ATOMIC_ACQUIRE);
+	while (c != 0) {
+		futex_wait (&m->state, 2);
+		c = __atomic_exchange_n (&m->state, 2, __ATOMIC_ACQUIRE);
+	}
+	return 0;
+}
+
+/* Acquires M if it is free.  Returns 0 on success, -1 if M is
+   held. */
+int
+pthread_mutex_trylock (pthread_mutex_t *m) {
+	int c = 0;
+
+	return __atomic_compare_exchange_n (&m->state, &c, 1, false,
+	                                    __ATOMIC_ACQUIRE,
+	                                    __ATOMIC_RELAXED) ? 0 : -1;
+}
+
+/* Releases M, entering the kernel only if another thread may be
+   sleeping on it. */
+int
+pthread_mutex_unlock (pthread_mutex_t *m) {
+	if (__atomic_fetch_sub (&m->state, 1, __ATOMIC_RELEASE) != 1) {
+		__atomic_store_n (&m->state, 0, __ATOMIC_RELEASE);
+		futex_wake (&m->state, 1);
+	}
+	return 0;
+}
+
+int
+pthread_cond_init (pthread_cond_t *c) {
+	c->seq = 0;
+	return 0;
+}
+
+/* Releases M, sleeps until C is signaled, and reacquires M.  As
+   with any condition variable, callers must recheck their
+   predicate after it returns. */
+int
+pthread_cond_wait (pthread_cond_t *c, pthread_mutex_t *m) {
+	int seq = __atomic_load_n (&c->seq, __ATOMIC_RELAXED);
+
+	pthread_mutex_unlock (m);
+	futex_wait (&c->seq, seq);
+
+	/* Other waiters may have been woken too, so take M in the
+	   contended state to make sure its unlock wakes them. */
+	while (__atomic_exchange_n (&m->state, 2, __ATOMIC_ACQUIRE) != 0)
+		futex_wait (&m->state, 2);
+	return 0;
+}
+
+int
+pthread_cond_signal (pthread_cond_t *c) {
+	__atomic_fetch_add (&c->seq, 1, __ATOMIC_RELEASE);
+	futex_wake (&c->seq, 1);
+	return 0;
+}
+
+int
+pthread_cond_broadcast (pthread_cond_t *c) {
+	__atomic_fetch_add (&c->seq, 1, __ATOMIC_RELEASE);
+	futex_wake (&c->seq, INT_MAX);
+	return 0;
+}
@@ -194,3 +194,29 @@ int
 umount (const char *path) {
 	return syscall1 (SYS_UMOUNT, path);
 }
+
+int
+thread_create (void (*entry) (void *), void *arg, void *stack) {
+	return syscall3 (SYS_THREAD_CREATE, entry, arg, stack);
+}
+
+void
+thread_exit (void) {
+	syscall0 (SYS_THREAD_EXIT);
+	NOT_REACHED ();
+}
+
+int
+thread_join (int tid) {
+	return syscall1 (SYS_THREAD_JOIN, tid);
+}
+
+int
+futex_wait (int *uaddr, int val) {
+	return syscall2 (SYS_FUTEX_WAIT, uaddr, val);
+}
+
+int
+futex_wake (int *uaddr, int cnt) {
+	return syscall2 (SYS_FUTEX_WAKE, uaddr, cnt);
+}
@@ -0,0 +1,81 @@
+/* Measures the bitmap library on a 1M-bit map, the size of the
+   free map of a 512 MB disk.  Each case is timed with the
+   time-stamp counter and reported in cycles per operation:
+
+   - scan-hole: finding the only clear bit, at the very end of an
+     otherwise full map.
+   - scan-run: finding a run of RUN_BITS clear bits at the end of a
+     map in which every 64th bit is set.
+   - alloc: taking ALLOC_CNT single bits one after another with
+     bitmap_scan_and_flip(), as the swap and free maps do.
+   - count: counting the clear bits of the whole map.
+
+   This is a benchmark, not a pass/fail test, so it is not part
+   of the graded test list.  Run it with `pintos -- run bitmap-bench'. */
+
+#include <bitmap.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "intrinsic.h"
+
+#define BIT_CNT (1024 * 1024)
+#define RUN_BITS 512
+#define ALLOC_CNT 65536
+#define REPEAT_CNT 100
+
+static void report (const char *name, uint64_t cycles, unsigned cnt);
+
+void
+test_bitmap_bench (void) 
+{
+  struct bitmap *b = bitmap_create (BIT_CNT);
+  uint64_t start;
+  size_t i;
+
+  if (b == NULL)
+    fail ("can't allocate %d-bit bitmap", BIT_CNT);
+
+  /* One clear bit, at the end. */
+  bitmap_set_all (b, true);
+  bitmap_reset (b, BIT_CNT - 1);
+  start = rdtsc ();
+  for (i = 0; i < REPEAT_CNT; i++)
+    if (bitmap_scan (b, 0, 1, false) != BIT_CNT - 1)
+      fail ("scan-hole found the wrong bit");
+  report ("scan-hole", rdtsc () - start, REPEAT_CNT);
+
+  /* Short clear runs everywhere, one long enough at the end. */
+  bitmap_set_all (b, false);
+  for (i = 0; i < BIT_CNT - RUN_BITS; i += 64)
+    bitmap_mark (b, i);
+  start = rdtsc ();
+  for (i = 0; i < REPEAT_CNT; i++)
+    if (bitmap_scan (b, 0, RUN_BITS, false) == BITMAP_ERROR)
+      fail ("scan-run found no run");
+  report ("scan-run", rdtsc () - start, REPEAT_CNT);
+
+  /* Single-bit allocation from an empty map. */
+  bitmap_set_all (b, false);
+  start = rdtsc ();
+  for (i = 0; i < ALLOC_CNT; i++)
+    if (bitmap_scan_and_flip (b, 0, 1, false) != i)
+      fail ("alloc returned the wrong bit");
+  report ("alloc", rdtsc () - start, ALLOC_CNT);
+
+  start = rdtsc ();
+  for (i = 0; i < REPEAT_CNT; i++)
+    if (bitmap_count (b, 0, BIT_CNT, false) != BIT_CNT - ALLOC_CNT)
+      fail ("count is wrong");
+  report ("count", rdtsc () - start, REPEAT_CNT);
+
+  bitmap_destroy (b);
+}
+
+/* Prints CYCLES spent on CNT operations of the case NAME. */
+static void
+report (const char *name, uint64_t cycles, unsigned cnt) 
+{
+  msg ("%s: %llu cycles per operation", name,
+       (unsigned long long) (cycles / cnt));
+}
@@ -0,0 +1,84 @@
+/* Measures the kernel heap on a mixed workload.
+
+   - footprint: BLOCK_CNT live blocks, half of them small (under
+     128 bytes), three in ten medium (up to 1 kB) and the rest
+     between 1 and 4 kB, as the kernel's own structures and
+     buffers are.  Reports the bytes asked for against the pages
+     malloc() took from the page allocator for them.
+   - pair: a malloc() immediately followed by a free() of the
+     same size, in cycles per pair.
+   - realloc: a buffer grown 16 bytes at a time to 4 kB, and how
+     many of the calls had to move it.
+
+   This is a benchmark, not a pass/fail test, so it is not part
+   of the graded test list.  Run it with `pintos -- run malloc-bench'. */
+
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "intrinsic.h"
+
+#define BLOCK_CNT 2000
+#define PAIR_CNT 100000
+#define GROW_MAX 4096
+#define GROW_STEP 16
+
+static void *blocks[BLOCK_CNT];
+
+void
+test_malloc_bench (void) 
+{
+  size_t requested = 0, base_pages, pages;
+  size_t size, moves = 0;
+  uint64_t start;
+  void *p;
+  int i;
+
+  /* Footprint of a mixed set of live blocks. */
+  random_init (0);
+  base_pages = malloc_page_cnt ();
+  for (i = 0; i < BLOCK_CNT; i++) 
+    {
+      unsigned long r = random_ulong ();
+
+      if (r % 10 < 5)
+        size = 8 + r / 10 % 120;
+      else if (r % 10 < 8)
+        size = 129 + r / 10 % 896;
+      else
+        size = 1025 + r / 10 % 3072;
+      blocks[i] = malloc (size);
+      if (blocks[i] == NULL)
+        fail ("can't allocate block %d", i);
+      requested += size;
+    }
+  pages = malloc_page_cnt () - base_pages;
+  msg ("footprint: %zu kB requested, %zu kB of pages (%zu%%)",
+       requested / 1024, pages * 4, pages * 4096 * 100 / requested);
+  for (i = 0; i < BLOCK_CNT; i++)
+    free (blocks[i]);
+
+  /* Allocation and release of the same size, back to back. */
+  start = rdtsc ();
+  for (i = 0; i < PAIR_CNT; i++)
+    free (malloc (64 + i % 8 * 16));
+  msg ("pair: %llu cycles per malloc/free",
+       (unsigned long long) ((rdtsc () - start) / PAIR_CNT));
+
+  /* Growing a buffer a little at a time. */
+  p = NULL;
+  for (size = GROW_STEP; size <= GROW_MAX; size += GROW_STEP) 
+    {
+      void *q = realloc (p, size);
+      if (q == NULL)
+        fail ("can't grow buffer to %zu bytes", size);
+      if (q != p)
+        moves++;
+      p = q;
+    }
+  free (p);
+  msg ("realloc: %zu of %d calls moved the block",
+       moves, GROW_MAX / GROW_STEP);
+}
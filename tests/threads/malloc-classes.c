@@ -0,0 +1,134 @@
+/* Checks the kernel heap's size classes.
+
+   - Every size up to a little past the largest class: two blocks
+     of that size must be distinct, aligned, and hold the full
+     size without overlapping.
+   - Enough blocks of several large sizes to fill multi-page
+     arenas, each block filled to its last byte.  free() finds a
+     large block's arena through a header just in front of it, so
+     a block that spilled into its neighbour's header makes free()
+     fail an assertion.
+   - realloc() to a size in the same class keeps the block.
+   - Once everything is freed and the magazines are flushed,
+     malloc() holds no more pages than before the test. */
+
+#include <stdint.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+
+/* A little past the largest class, into big blocks. */
+#define SIZE_MAX_TESTED 4160
+
+/* Blocks bigger than PAGE_CLASS_MAX, up to CLASS_MAX, come from
+   multi-page arenas, whose blocks are 16-byte aligned.  All others
+   are 8-byte aligned. */
+#define PAGE_CLASS_MAX 512
+#define CLASS_MAX 4096
+
+#define LARGE_CNT 24
+
+static void fill (uint8_t *, size_t, uint8_t);
+static void check (const uint8_t *, size_t, uint8_t, const char *what);
+
+void
+test_malloc_classes (void) 
+{
+  static const size_t large_sizes[] = {513, 600, 1000, 1500, 2048, 3000, 4096};
+  static uint8_t *large[LARGE_CNT];
+  size_t base_pages, size, i, j;
+  uint8_t *p, *q;
+  uintptr_t old;
+
+  malloc_flush ();
+  base_pages = malloc_page_cnt ();
+
+  /* Every size. */
+  for (size = 1; size <= SIZE_MAX_TESTED; size++) 
+    {
+      size_t align = size > PAGE_CLASS_MAX && size <= CLASS_MAX ? 16 : 8;
+
+      p = malloc (size);
+      q = malloc (size);
+      if (p == NULL || q == NULL)
+        fail ("malloc (%zu) failed", size);
+      if (p == q)
+        fail ("malloc (%zu) returned the same block twice", size);
+      if ((uintptr_t) p % align != 0 || (uintptr_t) q % align != 0)
+        fail ("malloc (%zu) returned %p and %p, not %zu-byte aligned",
+              size, p, q, align);
+      fill (p, size, 0x5a);
+      fill (q, size, 0xa5);
+      check (p, size, 0x5a, "block of every size");
+      check (q, size, 0xa5, "block of every size");
+      free (p);
+      free (q);
+    }
+  msg ("every size up to %d bytes", SIZE_MAX_TESTED);
+
+  /* Full multi-page arenas. */
+  for (i = 0; i < sizeof large_sizes / sizeof *large_sizes; i++) 
+    {
+      size = large_sizes[i];
+      for (j = 0; j < LARGE_CNT; j++) 
+        {
+          large[j] = malloc (size);
+          if (large[j] == NULL)
+            fail ("malloc (%zu) failed", size);
+          fill (large[j], size, j);
+        }
+      for (j = 0; j < LARGE_CNT; j++)
+        check (large[j], size, j, "large block");
+      for (j = 0; j < LARGE_CNT; j++)
+        free (large[j]);
+    }
+  msg ("full arenas of large blocks");
+
+  /* realloc() within a class.  Compare addresses, not pointers,
+     since the old pointer is dead once realloc() returns. */
+  p = malloc (100);
+  fill (p, 100, 0x3c);
+  old = (uintptr_t) p;
+  p = realloc (p, 110);
+  if ((uintptr_t) p != old || (uintptr_t) (p = realloc (p, 97)) != old)
+    fail ("realloc() moved a block within its size class");
+  check (p, 97, 0x3c, "block after realloc");
+  p = realloc (p, 1000);
+  if (p == NULL)
+    fail ("realloc (1000) failed");
+  check (p, 97, 0x3c, "block moved by realloc");
+  fill (p, 1000, 0xc3);
+  old = (uintptr_t) p;
+  p = realloc (p, 990);
+  if ((uintptr_t) p != old)
+    fail ("realloc() moved a large block within its size class");
+  check (p, 990, 0xc3, "large block after realloc");
+  free (p);
+  msg ("realloc within a size class");
+
+  /* Everything went back. */
+  malloc_flush ();
+  if (malloc_page_cnt () != base_pages)
+    fail ("malloc holds %zu pages after the test, %zu before",
+          malloc_page_cnt (), base_pages);
+  msg ("pages returned after flush");
+}
+
+/* Fills the SIZE bytes at P with VALUE. */
+static void
+fill (uint8_t *p, size_t size, uint8_t value) 
+{
+  memset (p, value, size);
+}
+
+/* Fails unless all SIZE bytes at P equal VALUE. */
+static void
+check (const uint8_t *p, size_t size, uint8_t value, const char *what) 
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    if (p[i] != value)
+      fail ("%s of %zu bytes: byte %zu is %#x, not %#x",
+            what, size, i, p[i], value);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(malloc-classes) begin
+(malloc-classes) every size up to 4160 bytes
+(malloc-classes) full arenas of large blocks
+(malloc-classes) realloc within a size class
+(malloc-classes) pages returned after flush
+(malloc-classes) end
+EOF
+pass;
@@ -0,0 +1,71 @@
+/* The main thread acquires a lock.  A reader takes an rwlock for
+   reading and then blocks on that lock.  A higher-priority writer
+   then blocks on the rwlock, donating its priority to the reader,
+   and the donation must carry on through the reader to the main
+   thread, which holds the lock the reader is waiting for. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+struct locks
+  {
+    struct lock lock;
+    struct rwlock rw;
+  };
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_rwlock_donate_chain (void)
+{
+  struct locks locks;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  lock_init (&locks.lock);
+  rwlock_init (&locks.rw);
+  lock_acquire (&locks.lock);
+
+  thread_create ("reader", PRI_DEFAULT + 1, reader_thread_func, &locks);
+  msg ("main should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 1, thread_get_priority ());
+
+  thread_create ("writer", PRI_DEFAULT + 9, writer_thread_func, &locks);
+  msg ("main should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 9, thread_get_priority ());
+
+  lock_release (&locks.lock);
+  msg ("main should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+}
+
+static void
+reader_thread_func (void *locks_)
+{
+  struct locks *locks = locks_;
+
+  rwlock_acquire_read (&locks->rw);
+  lock_acquire (&locks->lock);
+  msg ("reader got the lock.");
+  lock_release (&locks->lock);
+  rwlock_release_read (&locks->rw);
+  msg ("reader finished.");
+}
+
+static void
+writer_thread_func (void *locks_)
+{
+  struct locks *locks = locks_;
+
+  rwlock_acquire_write (&locks->rw);
+  msg ("writer got the rwlock.");
+  rwlock_release_write (&locks->rw);
+}
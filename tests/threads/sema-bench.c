@@ -0,0 +1,89 @@
+/* Measures the cost of waking the highest-priority waiter of a
+   contended semaphore.  WAITER_CNT threads at mixed priorities
+   block on one semaphore, then the main thread, running above all
+   of them, ups it once per waiter and the elapsed time-stamp
+   counter cycles are reported per sema_up().  This is repeated
+   ROUND_CNT times.
+
+   This is a benchmark, not a pass/fail test, so it is not part
+   of the graded test list.  Run it with `pintos -- run sema-bench'. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+#define WAITER_CNT 64
+#define ROUND_CNT 100
+
+struct sema_bench
+  {
+    struct semaphore sema;      /* Semaphore the waiters contend on. */
+    struct semaphore done;      /* Upped by each waiter before it blocks. */
+  };
+
+static thread_func waiter_func;
+
+void
+test_sema_bench (void) 
+{
+  struct sema_bench b;
+  uint64_t cycles = 0;
+  int i, round;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&b.sema, 0);
+  sema_init (&b.done, 0);
+
+  /* Let every waiter run to its first sema_down(). */
+  thread_set_priority (PRI_MIN);
+  for (i = 0; i < WAITER_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "waiter %d", i);
+      thread_create (name, PRI_MIN + 1 + (i * 7) % (PRI_DEFAULT - PRI_MIN),
+                     waiter_func, &b);
+    }
+
+  for (round = 0; round < ROUND_CNT; round++) 
+    {
+      uint64_t start;
+
+      for (i = 0; i < WAITER_CNT; i++)
+        sema_down (&b.done);
+
+      /* Wake everyone without being preempted, then drop below the
+         waiters so they can go back to sleep. */
+      thread_set_priority (PRI_MAX);
+      start = rdtsc ();
+      for (i = 0; i < WAITER_CNT; i++)
+        sema_up (&b.sema);
+      cycles += rdtsc () - start;
+      thread_set_priority (PRI_MIN);
+    }
+  for (i = 0; i < WAITER_CNT; i++)
+    sema_down (&b.done);
+  thread_set_priority (PRI_DEFAULT);
+
+  msg ("%d waiters, %llu cycles per sema_up",
+       WAITER_CNT,
+       (unsigned long long) (cycles / (ROUND_CNT * WAITER_CNT)));
+}
+
+static void 
+waiter_func (void *b_) 
+{
+  struct sema_bench *b = b_;
+  int round;
+
+  for (round = 0; round < ROUND_CNT; round++) 
+    {
+      sema_up (&b->done);
+      sema_down (&b->sema);
+    }
+  sema_up (&b->done);
+}
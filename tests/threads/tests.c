@@ -29,6 +29,14 @@ static const struct test tests[] =
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
+    {"workqueue-priority", test_workqueue_priority},
+    {"workqueue-delay", test_workqueue_delay},
+    {"malloc-classes", test_malloc_classes},
+    {"rwlock-donate-chain", test_rwlock_donate_chain},
+    {"yield-bench", test_yield_bench},
+    {"sema-bench", test_sema_bench},
+    {"bitmap-bench", test_bitmap_bench},
+    {"malloc-bench", test_malloc_bench},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
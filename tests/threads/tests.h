@@ -23,6 +23,14 @@ extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_workqueue_priority;
+extern test_func test_workqueue_delay;
+extern test_func test_malloc_classes;
+extern test_func test_rwlock_donate_chain;
+extern test_func test_yield_bench;
+extern test_func test_sema_bench;
+extern test_func test_bitmap_bench;
+extern test_func test_malloc_bench;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
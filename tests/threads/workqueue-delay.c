@@ -0,0 +1,92 @@
+/* Arms delayed work items with different delays, in an order that
+   differs from their expiry order, and checks that each runs in
+   expiry order and not before its delay has passed.  One more item
+   is cancelled before it expires and must never run. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+
+#define ITEM_CNT 3
+
+struct item
+  {
+    struct delayed_work dw;
+    int id;
+    int64_t delay;              /* Ticks to wait before running. */
+    int64_t ran;                /* Tick it ran at, or -1. */
+  };
+
+static struct item items[ITEM_CNT + 1];
+static struct item *order[ITEM_CNT + 1];
+static int order_cnt;
+static struct semaphore done;
+
+static void record (struct work *);
+
+void
+test_workqueue_delay (void) 
+{
+  static const int64_t delays[ITEM_CNT + 1] = {30, 10, 20, 5};
+  struct item *cancelled = &items[ITEM_CNT];
+  int64_t start;
+  int i;
+
+  sema_init (&done, 0);
+
+  /* Start at the very beginning of a timer tick. */
+  start = timer_ticks ();
+  while (timer_elapsed (start) == 0)
+    continue;
+  start = timer_ticks ();
+
+  for (i = 0; i < ITEM_CNT + 1; i++) 
+    {
+      items[i].id = i;
+      items[i].delay = delays[i];
+      items[i].ran = -1;
+      delayed_work_init (&items[i].dw, record, &items[i]);
+      if (!queue_delayed_work (&system_wq, &items[i].dw, delays[i]))
+        fail ("could not arm work %d", i);
+    }
+  if (queue_delayed_work (&system_wq, &items[0].dw, 1))
+    fail ("armed work 0 twice");
+  if (!cancel_delayed_work (&cancelled->dw))
+    fail ("could not cancel work %d", cancelled->id);
+  msg ("Cancelled work %d.", cancelled->id);
+
+  /* The cancelled item would have expired first, so if it was not
+     really cancelled it shows up in ORDER ahead of the others. */
+  for (i = 0; i < ITEM_CNT; i++)
+    sema_down (&done);
+
+  for (i = 0; i < order_cnt; i++) 
+    {
+      struct item *item = order[i];
+
+      if (item->ran - start < item->delay)
+        fail ("work %d ran after %lld ticks, before its delay of %lld",
+              item->id, item->ran - start, item->delay);
+      msg ("Work %d ran after its delay of %lld ticks.",
+           item->id, item->delay);
+    }
+}
+
+static void
+record (struct work *w) 
+{
+  struct item *item = w->aux;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  item->ran = timer_ticks ();
+  order[order_cnt++] = item;
+  intr_set_level (old_level);
+
+  sema_up (&done);
+}
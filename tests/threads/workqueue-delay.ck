@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue-delay) begin
+(workqueue-delay) Cancelled work 3.
+(workqueue-delay) Work 1 ran after its delay of 10 ticks.
+(workqueue-delay) Work 2 ran after its delay of 20 ticks.
+(workqueue-delay) Work 0 ran after its delay of 30 ticks.
+(workqueue-delay) end
+EOF
+pass;
@@ -0,0 +1,87 @@
+/* Queues three items on each of two workqueues while the worker
+   threads cannot run yet, then checks that the workers ran every
+   item of the higher priority queue first, each queue in FIFO
+   order, and each item at its queue's priority.  Also checks that
+   an item already pending cannot be queued twice. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+
+#define ITEM_CNT 3
+
+struct item
+  {
+    struct work work;
+    const char *queue;          /* Name of the queue it goes on. */
+    int id;                     /* Index within that queue. */
+    int priority;               /* Priority it ran at. */
+  };
+
+static struct workqueue high_wq, low_wq;
+static struct item high_items[ITEM_CNT], low_items[ITEM_CNT];
+static struct item *order[ITEM_CNT * 2];
+static int order_cnt;
+static struct semaphore done;
+
+static void record (struct work *);
+
+void
+test_workqueue_priority (void) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+  workqueue_create (&high_wq, "high", PRI_DEFAULT + 10);
+  workqueue_create (&low_wq, "low", PRI_DEFAULT - 10);
+
+  /* Keep the workers from running until everything is queued.
+     Queue the low priority items first. */
+  thread_set_priority (PRI_MAX);
+  for (i = 0; i < ITEM_CNT; i++) 
+    {
+      low_items[i].queue = "low";
+      low_items[i].id = i;
+      work_init (&low_items[i].work, record, &low_items[i]);
+      queue_work (&low_wq, &low_items[i].work);
+    }
+  for (i = 0; i < ITEM_CNT; i++) 
+    {
+      high_items[i].queue = "high";
+      high_items[i].id = i;
+      work_init (&high_items[i].work, record, &high_items[i]);
+      queue_work (&high_wq, &high_items[i].work);
+    }
+  if (queue_work (&high_wq, &high_items[0].work))
+    fail ("queued a pending item twice");
+
+  for (i = 0; i < ITEM_CNT * 2; i++)
+    sema_down (&done);
+  thread_set_priority (PRI_DEFAULT);
+
+  for (i = 0; i < order_cnt; i++)
+    msg ("%s item %d ran at priority %d.",
+         order[i]->queue, order[i]->id, order[i]->priority);
+}
+
+static void
+record (struct work *w) 
+{
+  struct item *item = w->aux;
+  enum intr_level old_level;
+
+  item->priority = thread_get_priority ();
+
+  old_level = intr_disable ();
+  order[order_cnt++] = item;
+  intr_set_level (old_level);
+
+  sema_up (&done);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue-priority) begin
+(workqueue-priority) high item 0 ran at priority 41.
+(workqueue-priority) high item 1 ran at priority 41.
+(workqueue-priority) high item 2 ran at priority 41.
+(workqueue-priority) low item 0 ran at priority 21.
+(workqueue-priority) low item 1 ran at priority 21.
+(workqueue-priority) low item 2 ran at priority 21.
+(workqueue-priority) end
+EOF
+pass;
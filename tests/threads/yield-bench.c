@@ -0,0 +1,52 @@
+/* Measures the cost of a thread switch.  Two threads at the same
+   priority yield to each other YIELD_CNT times and the elapsed
+   time-stamp counter cycles are reported per yield.
+
+   This is a benchmark, not a pass/fail test, so it is not part
+   of the graded test list.  Run it with `pintos -- run yield-bench'. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+#define YIELD_CNT 100000
+
+static thread_func yield_thread_func;
+
+void
+test_yield_bench (void) 
+{
+  struct semaphore done;
+  uint64_t start, cycles;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+  thread_create ("yielder", PRI_DEFAULT, yield_thread_func, &done);
+
+  start = rdtsc ();
+  for (i = 0; i < YIELD_CNT; i++)
+    thread_yield ();
+  cycles = rdtsc () - start;
+  sema_down (&done);
+
+  /* Each of our yields switches to the other thread and back. */
+  msg ("%d yields, %llu cycles per yield",
+       YIELD_CNT * 2, (unsigned long long) (cycles / (YIELD_CNT * 2)));
+}
+
+static void 
+yield_thread_func (void *done_) 
+{
+  struct semaphore *done = done_;
+  int i;
+
+  for (i = 0; i < YIELD_CNT; i++)
+    thread_yield ();
+  sema_up (done);
+}
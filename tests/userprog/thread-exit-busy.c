@@ -0,0 +1,44 @@
+/* The main thread exits while one sibling spins in user mode
+   without ever making a system call and another sleeps on a mutex
+   the main thread holds.  The process must still end, with only the
+   main thread's exit status reported. */
+
+#include <pthread.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static volatile int spinning;
+
+static void *
+spin (void *arg UNUSED) 
+{
+  spinning = 1;
+  for (;;)
+    continue;
+  return NULL;
+}
+
+static void *
+sleep_on_mutex (void *arg UNUSED) 
+{
+  pthread_mutex_lock (&mutex);
+  fail ("acquired a mutex the main thread never released");
+  return NULL;
+}
+
+void
+test_main (void) 
+{
+  pthread_t spinner, sleeper;
+
+  pthread_mutex_lock (&mutex);
+  CHECK (pthread_create (&spinner, spin, NULL) == 0, "create spinner");
+  CHECK (pthread_create (&sleeper, sleep_on_mutex, NULL) == 0,
+         "create sleeper");
+
+  while (!spinning)
+    continue;
+  msg ("spinner is running");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-exit-busy) begin
+(thread-exit-busy) create spinner
+(thread-exit-busy) create sleeper
+(thread-exit-busy) spinner is running
+(thread-exit-busy) end
+thread-exit-busy: exit(0)
+EOF
+pass;
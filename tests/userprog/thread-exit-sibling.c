@@ -0,0 +1,26 @@
+/* A thread other than the main thread calls exit() while the main
+   thread spins in user mode.  exit() ends the whole process, so the
+   process must end with the sibling's exit status. */
+
+#include <pthread.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static void *
+exit_process (void *arg UNUSED) 
+{
+  msg ("exiting from a sibling thread");
+  exit (57);
+}
+
+void
+test_main (void) 
+{
+  pthread_t sibling;
+
+  if (pthread_create (&sibling, exit_process, NULL) != 0)
+    fail ("create sibling");
+  for (;;)
+    continue;
+}
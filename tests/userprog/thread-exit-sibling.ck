@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-exit-sibling) begin
+(thread-exit-sibling) exiting from a sibling thread
+thread-exit-sibling: exit(57)
+EOF
+pass;
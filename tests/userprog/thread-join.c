@@ -0,0 +1,47 @@
+/* Creates several threads that write into memory shared with the
+   main thread, joins each of them, and checks their return values
+   and what they wrote. */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+
+static int squares[THREAD_CNT];
+
+static void *
+square (void *arg) 
+{
+  int i = (intptr_t) arg;
+
+  squares[i] = i * i;
+  return (void *) (intptr_t) (i + 100);
+}
+
+void
+test_main (void) 
+{
+  pthread_t threads[THREAD_CNT];
+  int i;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK (pthread_create (&threads[i], square, (void *) (intptr_t) i) == 0,
+           "create thread %d", i);
+
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      void *retval;
+
+      CHECK (pthread_join (threads[i], &retval) == 0, "join thread %d", i);
+      if ((intptr_t) retval != i + 100)
+        fail ("thread %d returned %d, expected %d",
+              i, (int) (intptr_t) retval, i + 100);
+      if (squares[i] != i * i)
+        fail ("thread %d stored %d, expected %d", i, squares[i], i * i);
+    }
+
+  CHECK (thread_join (-1) == -1, "join bogus tid");
+}
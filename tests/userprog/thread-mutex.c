@@ -0,0 +1,54 @@
+/* Several threads increment a shared counter under a futex-based
+   mutex.  Each increment is a slow read-modify-write, so threads
+   are preempted inside the critical section and the others have to
+   sleep on the mutex.  Any lost update shows up in the final
+   count. */
+
+#include <pthread.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+#define ITER_CNT 2000
+#define SPIN_CNT 1000
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static int counter;
+
+static void *
+increment (void *arg UNUSED) 
+{
+  int i;
+
+  for (i = 0; i < ITER_CNT; i++) 
+    {
+      volatile int spin;
+      int value;
+
+      pthread_mutex_lock (&mutex);
+      value = counter;
+      for (spin = 0; spin < SPIN_CNT; spin++)
+        continue;
+      counter = value + 1;
+      pthread_mutex_unlock (&mutex);
+    }
+  return NULL;
+}
+
+void
+test_main (void) 
+{
+  pthread_t threads[THREAD_CNT];
+  int i;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK (pthread_create (&threads[i], increment, NULL) == 0,
+           "create thread %d", i);
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK (pthread_join (threads[i], NULL) == 0, "join thread %d", i);
+
+  if (counter != THREAD_CNT * ITER_CNT)
+    fail ("counter is %d, expected %d", counter, THREAD_CNT * ITER_CNT);
+  msg ("counter is %d", counter);
+}
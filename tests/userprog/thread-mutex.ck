@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-mutex) begin
+(thread-mutex) create thread 0
+(thread-mutex) create thread 1
+(thread-mutex) create thread 2
+(thread-mutex) create thread 3
+(thread-mutex) join thread 0
+(thread-mutex) join thread 1
+(thread-mutex) join thread 2
+(thread-mutex) join thread 3
+(thread-mutex) counter is 8000
+(thread-mutex) end
+thread-mutex: exit(0)
+EOF
+pass;
@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "devices/hrtimer.h"
 #include "devices/kbd.h"
 #include "devices/input.h"
 #include "devices/serial.h"
@@ -20,7 +21,9 @@
 #include "threads/mmu.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -29,6 +32,7 @@
 #include "userprog/tss.h"
 #endif
 #include "tests/threads/tests.h"
+#include "intrinsic.h"
 #ifdef VM
 #include "vm/vm.h"
 #endif
@@ -51,6 +55,20 @@ bool power_off_when_done;
 
 bool thread_tests;
 
+/* Boot phase timestamps, recorded by boot_phase() as main()
+   finishes each init step and printed at "Boot complete". */
+struct boot_phase {
+	const char *name;           /* Step that just finished. */
+	uint64_t tsc;               /* TSC when it finished. */
+};
+#define BOOT_PHASE_CNT 16
+static struct boot_phase boot_phases[BOOT_PHASE_CNT];
+static int boot_phase_cnt;
+static uint64_t boot_start_tsc;
+
+static void boot_phase (const char *name);
+static void print_boot_phases (void);
+
 static void bss_init (void);
 static void paging_init (uint64_t mem_end);
 
@@ -72,20 +90,25 @@ main (void) {
 
 	/* Clear BSS and get machine's RAM size. */
 	bss_init ();
+	boot_start_tsc = rdtsc ();
 
 	/* Break command line into arguments and parse options. */
 	argv = read_command_line ();
 	argv = parse_options (argv);
+	boot_phase ("command line");
 
 	/* Initialize ourselves as a thread so we can use locks,
 	   then enable console locking. */
 	thread_init ();
 	console_init ();
+	boot_phase ("thread, console");
 
 	/* Initialize memory system. */
 	mem_end = palloc_init ();
 	malloc_init ();
+	kmem_init ();
 	paging_init (mem_end);
+	boot_phase ("memory");
 
 #ifdef USERPROG
 	tss_init ();
@@ -101,22 +124,35 @@ main (void) {
 	exception_init ();
 	syscall_init ();
 #endif
+	boot_phase ("interrupts");
+
 	/* Start thread scheduler and enable interrupts. */
 	thread_start ();
 	serial_init_queue ();
+	boot_phase ("scheduler");
+
+	/* Calibrate the TSC first; the delay loop is timed with it. */
+	hrtimer_init ();
 	timer_calibrate ();
+	boot_phase ("calibration");
+	workqueue_init ();
+	boot_phase ("workqueues");
 
 #ifdef FILESYS
 	/* Initialize file system. */
 	disk_init ();
+	boot_phase ("disks");
 	filesys_init (format_filesys);
+	boot_phase ("file system");
 #endif
 
 #ifdef VM
 	vm_init ();
+	boot_phase ("vm");
 #endif
 
 	printf ("Boot complete.\n");
+	print_boot_phases ();
 
 	/* Run actions specified on kernel command line. */
 	run_actions (argv);
@@ -127,6 +163,35 @@ main (void) {
 	thread_exit ();
 }
 
+/* Records that boot step NAME has just finished. */
+static void
+boot_phase (const char *name) {
+	if (boot_phase_cnt < BOOT_PHASE_CNT) {
+		boot_phases[boot_phase_cnt].name = name;
+		boot_phases[boot_phase_cnt].tsc = rdtsc ();
+		boot_phase_cnt++;
+	}
+}
+
+/* Prints how long each boot step took, in TSC cycles and, once
+   the TSC is calibrated, microseconds. */
+static void
+print_boot_phases (void) {
+	uint64_t prev = boot_start_tsc;
+	int i;
+
+	printf ("Boot phases:\n");
+	for (i = 0; i < boot_phase_cnt; i++) {
+		uint64_t cycles = boot_phases[i].tsc - prev;
+
+		printf ("  %-16s %'14llu cycles %'10llu us\n", boot_phases[i].name,
+				cycles, hrtimer_cycles_to_ns (cycles) / 1000);
+		prev = boot_phases[i].tsc;
+	}
+	printf ("  %-16s %'14llu cycles %'10llu us\n", "total",
+			prev - boot_start_tsc, hrtimer_cycles_to_ns (prev - boot_start_tsc) / 1000);
+}
+
 /* Clear BSS */
 static void
 bss_init (void) {
@@ -221,6 +286,12 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-stride"))
+			thread_stride = true;
+		else if (!strcmp (name, "-tickless"))
+			timer_tickless = true;
+		else if (!strcmp (name, "-lockstat"))
+			lockstat_top = value != NULL ? atoi (value) : 10;
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
@@ -326,6 +397,9 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -stride            Use stride (proportional-share) scheduler.\n"
+			"  -tickless          Stop the periodic timer tick while idle.\n"
+			"  -lockstat[=N]      Report the N most contended locks at exit.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -354,6 +428,11 @@ static void
 print_stats (void) {
 	timer_print_stats ();
 	thread_print_stats ();
+	palloc_print_stats ();
+	malloc_print_stats ();
+	kmem_print_stats ();
+	lock_print_stats ();
+	workqueue_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
 #endif
@@ -9,10 +9,12 @@
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
+#include "devices/lapic.h"
 #include "devices/timer.h"
 #include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/gdt.h"
+#include "userprog/process.h"
 #endif
 
 /* Number of x86_64 interrupts. */
@@ -223,11 +225,12 @@ register_handler (uint8_t vec_no, int dpl, enum intr_level level,
 
 /* Registers external interrupt VEC_NO to invoke HANDLER, which
    is named NAME for debugging purposes.  The handler will
-   execute with interrupts disabled. */
+   execute with interrupts disabled.  Vectors 0x20...0x2f come
+   from the PICs and 0x30...0x3f from the local APIC. */
 void
 intr_register_ext (uint8_t vec_no, intr_handler_func *handler,
 		const char *name) {
-	ASSERT (vec_no >= 0x20 && vec_no <= 0x2f);
+	ASSERT (vec_no >= 0x20 && vec_no <= 0x3f);
 	register_handler (vec_no, 0, INTR_OFF, handler, name);
 }
 
@@ -248,7 +251,7 @@ void
 intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
 		intr_handler_func *handler, const char *name)
 {
-	ASSERT (vec_no < 0x20 || vec_no > 0x2f);
+	ASSERT (vec_no < 0x20 || vec_no > 0x3f);
 	register_handler (vec_no, dpl, level, handler, name);
 }
 
@@ -337,7 +340,7 @@ intr_handler (struct intr_frame *frame) {
 	   We only handle one at a time (so interrupts must be off)
 	   and they need to be acknowledged on the PIC (see below).
 	   An external interrupt handler cannot sleep. */
-	external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+	external = frame->vec_no >= 0x20 && frame->vec_no < 0x40;
 	if (external) {
 		ASSERT (intr_get_level () == INTR_OFF);
 		ASSERT (!intr_context ());
@@ -350,7 +353,8 @@ intr_handler (struct intr_frame *frame) {
 	handler = intr_handlers[frame->vec_no];
 	if (handler != NULL)
 		handler (frame);
-	else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f) {
+	else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f
+			|| frame->vec_no == LAPIC_SPURIOUS_VEC) {
 		/* There is no handler, but this interrupt can trigger
 		   spuriously due to a hardware fault or hardware race
 		   condition.  Ignore it. */
@@ -367,11 +371,21 @@ intr_handler (struct intr_frame *frame) {
 		ASSERT (intr_context ());
 
 		in_external_intr = false;
-		pic_end_of_interrupt (frame->vec_no);
+		if (frame->vec_no < 0x30)
+			pic_end_of_interrupt (frame->vec_no);
+		else if (frame->vec_no != LAPIC_SPURIOUS_VEC)
+			lapic_eoi ();
 
 		if (yield_on_return)
 			thread_yield ();
 	}
+
+#ifdef USERPROG
+	/* A user thread whose process is exiting must not go back to
+	   user mode, even if it never makes another system call. */
+	if (frame->cs == SEL_UCSEG)
+		process_check_kill ();
+#endif
 }
 
 /* Dumps interrupt frame F to the console, for debugging. */
@@ -5,41 +5,82 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request.
+   The size of each request, in bytes, is rounded up to the
+   nearest size class and assigned to the "descriptor" that
+   manages blocks of that size.  The descriptor keeps a list of
+   free blocks.  If the free list is nonempty, one of its blocks
+   is used to satisfy the request.
 
-   Otherwise, a new page of memory, called an "arena", is
-   obtained from the page allocator (if none is available,
-   malloc() returns a null pointer).  The new arena is divided
-   into blocks, all of which are added to the descriptor's free
-   list.  Then we return one of the new blocks.
+   Otherwise, a new run of pages, called an "arena", is obtained
+   from the page allocator (if none is available, malloc()
+   returns a null pointer).  The new arena is divided into
+   blocks, all of which are added to the descriptor's free list.
+   Then we return one of the new blocks.
 
    When we free a block, we add it to its descriptor's free list.
    But if the arena that the block was in now has no in-use
    blocks, we remove all of the arena's blocks from the free list
    and give the arena back to the page allocator.
 
-   We can't handle blocks bigger than 2 kB using this scheme,
-   because they're too big to fit in a single page with a
-   descriptor.  We handle those by allocating contiguous pages
-   with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   Size classes are 16 bytes apart up to 128 bytes.  Above that,
+   each power of two is split into CLASS_STEPS classes, so that a
+   block is at most about 12.5% bigger than the request.  Classes
+   up to PAGE_CLASS_MAX bytes use one-page arenas.  Larger ones,
+   up to CLASS_MAX bytes, use arenas of up to ARENA_PAGES_MAX
+   pages, as many as leaves the least of the arena unused.  Since
+   their blocks may start in any page of the arena, each block is
+   preceded by a small header that points to its arena.
+
+   The descriptors' free lists form the "depot".  In front of it,
+   each descriptor has a "magazine": a small stack of free blocks
+   that malloc() and free() push and pop with interrupts
+   disabled.  Only when a magazine runs empty or full does it go
+   to the depot, moving half a magazine's worth of blocks between
+   the two in one go, so that arena bookkeeping is done in
+   batches.  Blocks in a magazine still count as in use in their
+   arena, so magazines are kept small, especially for large
+   blocks, to avoid pinning arenas that could otherwise go back
+   to the page allocator.  The page allocator itself is only
+   called with interrupts on: malloc() gets a new arena before
+   disabling them, and arenas that become unused are collected
+   and freed after interrupts are restored.
+
+   Blocks bigger than CLASS_MAX bytes are handled by allocating
+   contiguous pages with the page allocator and sticking the
+   allocation size at the beginning of the allocated block's
+   arena header. */
+
+/* Size classes. */
+#define CLASS_MIN 16            /* Smallest class, and spacing up to 128. */
+#define CLASS_STEPS 8           /* Classes per power of two above 128. */
+#define PAGE_CLASS_MAX 512      /* Largest class with one-page arenas. */
+#define CLASS_MAX 4096          /* Largest class. */
+#define DESC_CNT 48             /* 8 up to 128, then 8 per doubling. */
+
+/* Most pages in a multi-page arena. */
+#define ARENA_PAGES_MAX 8
+
+/* Largest number of blocks in a magazine. */
+#define MAG_ROUNDS 8
 
 /* Descriptor. */
 struct desc {
 	size_t block_size;          /* Size of each element in bytes. */
+	size_t block_stride;        /* Distance between blocks in an arena. */
+	size_t block_ofs;           /* Offset of the first block in an arena. */
 	size_t blocks_per_arena;    /* Number of blocks in an arena. */
+	size_t arena_pages;         /* Number of pages in an arena. */
+	size_t mag_rounds;          /* Capacity of this size's magazines. */
 	struct list free_list;      /* List of free blocks. */
-	struct lock lock;           /* Lock. */
+	size_t arena_cnt;           /* Arenas allocated. */
+	uint64_t depot_cnt;         /* Magazine refills and drains. */
 };
 
 /* Magic number for detecting arena corruption. */
@@ -52,40 +93,100 @@ struct arena {
 	size_t free_cnt;            /* Free blocks; pages in big block. */
 };
 
+/* Header in front of each block of a multi-page arena. */
+struct block_hdr {
+	struct arena *arena;        /* Arena the block is in. */
+	size_t pad;                 /* Keeps the block 16-byte aligned. */
+};
+
 /* Free block. */
 struct block {
 	struct list_elem free_elem; /* Free list element. */
 };
 
+/* Blocks of one-page arenas and big blocks start right after a
+   24-byte struct arena, or a multiple of 16 bytes after that, so
+   they sit 8 bytes past a 16-byte boundary.  Blocks of multi-page
+   arenas are 16-byte aligned.  That tells free() where to look
+   for a block's arena. */
+#define IN_PAGE_ARENA(B) (((uintptr_t) (B) & 8) != 0)
+
+/* True if descriptor D's blocks have a struct block_hdr. */
+#define HAS_HDR(D) ((D)->block_size > PAGE_CLASS_MAX)
+
+/* Cache of free blocks of one descriptor. */
+struct magazine {
+	size_t cnt;                 /* Number of blocks in ROUNDS. */
+	struct block *rounds[MAG_ROUNDS]; /* Free blocks, a stack. */
+};
+
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
-static size_t desc_cnt;         /* Number of descriptors. */
+static struct desc descs[DESC_CNT];
+
+/* Magazines, indexed by descriptor.  The magazines and the
+   depot behind them are only touched with interrupts off. */
+static struct magazine mags[DESC_CNT];
+
+/* Pages held by big blocks. */
+static size_t big_page_cnt;
 
+static size_t class_size (size_t idx);
+static struct desc *size_to_desc (size_t size);
+static void arena_layout (struct desc *);
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static void arena_init (struct desc *, struct arena *);
+static void arenas_free (struct list *);
+static struct magazine *mag_current (struct desc *);
+static bool mag_refill (struct desc *, struct magazine *);
+static void mag_drain (struct desc *, struct magazine *, size_t cnt,
+		struct list *dead);
+static void mag_flush (struct list *dead);
+static struct block *depot_get (struct desc *);
+static void depot_put (struct desc *, struct block *, struct list *dead);
+static void depot_add (struct desc *, struct arena *);
 
 /* Initializes the malloc() descriptors. */
 void
 malloc_init (void) {
-	size_t block_size;
+	size_t i;
+
+	ASSERT (sizeof (struct arena) % 16 == 8);
+	ASSERT (sizeof (struct block_hdr) % 16 == 0);
+
+	for (i = 0; i < DESC_CNT; i++) {
+		struct desc *d = &descs[i];
+
+		d->block_size = class_size (i);
+		ASSERT (size_to_desc (d->block_size) == d);
+		ASSERT (i == 0 || size_to_desc (class_size (i - 1) + 1) == d);
+		arena_layout (d);
+
+		/* Let a magazine hold at most an arena's worth of blocks,
+		   rounded down to an even count so that refills and drains
+		   move half of it. */
+		d->mag_rounds = d->blocks_per_arena < MAG_ROUNDS
+			? d->blocks_per_arena & ~(size_t) 1 : MAG_ROUNDS;
+		if (d->mag_rounds < 2)
+			d->mag_rounds = 2;
 
-	for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2) {
-		struct desc *d = &descs[desc_cnt++];
-		ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
-		d->block_size = block_size;
-		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
 		list_init (&d->free_list);
-		lock_init (&d->lock);
+		d->arena_cnt = 0;
+		d->depot_cnt = 0;
 	}
+	ASSERT (descs[DESC_CNT - 1].block_size == CLASS_MAX);
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
    Returns a null pointer if memory is not available. */
 void *
 malloc (size_t size) {
+	enum intr_level old_level;
+	struct magazine *m;
 	struct desc *d;
 	struct block *b;
 	struct arena *a;
+	bool flushed = false;
 
 	/* A null pointer satisfies a request for 0 bytes. */
 	if (size == 0)
@@ -93,16 +194,15 @@ malloc (size_t size) {
 
 	/* Find the smallest descriptor that satisfies a SIZE-byte
 	   request. */
-	for (d = descs; d < descs + desc_cnt; d++)
-		if (d->block_size >= size)
-			break;
-	if (d == descs + desc_cnt) {
+	d = size_to_desc (size);
+	if (d == NULL) {
 		/* SIZE is too big for any descriptor.
 		   Allocate enough pages to hold SIZE plus an arena. */
 		size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
 		a = palloc_get_multiple (0, page_cnt);
 		if (a == NULL)
 			return NULL;
+		__atomic_add_fetch (&big_page_cnt, page_cnt, __ATOMIC_RELAXED);
 
 		/* Initialize the arena to indicate a big block of PAGE_CNT
 		   pages, and return it. */
@@ -112,35 +212,36 @@ malloc (size_t size) {
 		return a + 1;
 	}
 
-	lock_acquire (&d->lock);
-
-	/* If the free list is empty, create a new arena. */
-	if (list_empty (&d->free_list)) {
-		size_t i;
+	for (;;) {
+		/* Take a block from the magazine, refilling it from the
+		   depot if it is empty. */
+		old_level = intr_disable ();
+		m = mag_current (d);
+		if (m->cnt > 0 || mag_refill (d, m)) {
+			b = m->rounds[--m->cnt];
+			intr_set_level (old_level);
+			return b;
+		}
+		intr_set_level (old_level);
 
-		/* Allocate a page. */
-		a = palloc_get_page (0);
+		/* The depot is empty too, so add a new arena to it and try
+		   again.  If memory runs out, return every magazine to the
+		   depot, so that arenas they pinned can be freed, and try
+		   once more. */
+		a = palloc_get_multiple (0, d->arena_pages);
 		if (a == NULL) {
-			lock_release (&d->lock);
-			return NULL;
+			if (flushed)
+				return NULL;
+			malloc_flush ();
+			flushed = true;
+			continue;
 		}
+		arena_init (d, a);
 
-		/* Initialize arena and add its blocks to the free list. */
-		a->magic = ARENA_MAGIC;
-		a->desc = d;
-		a->free_cnt = d->blocks_per_arena;
-		for (i = 0; i < d->blocks_per_arena; i++) {
-			struct block *b = arena_to_block (a, i);
-			list_push_back (&d->free_list, &b->free_elem);
-		}
+		old_level = intr_disable ();
+		depot_add (d, a);
+		intr_set_level (old_level);
 	}
-
-	/* Get a block from free list and return it. */
-	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-	a = block_to_arena (b);
-	a->free_cnt--;
-	lock_release (&d->lock);
-	return b;
 }
 
 /* Allocates and return A times B bytes initialized to zeroes.
@@ -173,17 +274,32 @@ block_size (void *block) {
 	return d != NULL ? d->block_size : PGSIZE * a->free_cnt - pg_ofs (block);
 }
 
+/* Returns the number of bytes malloc(SIZE) would allocate. */
+static size_t
+alloc_size (size_t size) {
+	struct desc *d = size_to_desc (size);
+
+	return d != NULL ? d->block_size
+		: ROUND_UP (size + sizeof (struct arena), PGSIZE) - sizeof (struct arena);
+}
+
 /* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
    moving it in the process.
    If successful, returns the new block; on failure, returns a
    null pointer.
    A call with null OLD_BLOCK is equivalent to malloc(NEW_SIZE).
-   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
+   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK).
+   OLD_BLOCK is kept if it is the size malloc(NEW_SIZE) would
+   allocate anyway, so growing into the slack at the end of a
+   block costs nothing. */
 void *
 realloc (void *old_block, size_t new_size) {
 	if (new_size == 0) {
 		free (old_block);
 		return NULL;
+	} else if (old_block != NULL
+			&& block_size (old_block) == alloc_size (new_size)) {
+		return old_block;
 	} else {
 		void *new_block = malloc (new_size);
 		if (old_block != NULL && new_block != NULL) {
@@ -207,42 +323,288 @@ free (void *p) {
 
 		if (d != NULL) {
 			/* It's a normal block.  We handle it here. */
+			enum intr_level old_level;
+			struct magazine *m;
+			struct list dead;
 
 #ifndef NDEBUG
 			/* Clear the block to help detect use-after-free bugs. */
 			memset (b, 0xcc, d->block_size);
 #endif
 
-			lock_acquire (&d->lock);
-
-			/* Add block to free list. */
-			list_push_front (&d->free_list, &b->free_elem);
-
-			/* If the arena is now entirely unused, free it. */
-			if (++a->free_cnt >= d->blocks_per_arena) {
-				size_t i;
-
-				ASSERT (a->free_cnt == d->blocks_per_arena);
-				for (i = 0; i < d->blocks_per_arena; i++) {
-					struct block *b = arena_to_block (a, i);
-					list_remove (&b->free_elem);
-				}
-				palloc_free_page (a);
-			}
-
-			lock_release (&d->lock);
+			/* Put the block in the magazine, first draining
+			   half of it to the depot if it is full. */
+			list_init (&dead);
+			old_level = intr_disable ();
+			m = mag_current (d);
+			if (m->cnt >= d->mag_rounds)
+				mag_drain (d, m, d->mag_rounds / 2, &dead);
+			m->rounds[m->cnt++] = b;
+			intr_set_level (old_level);
+			arenas_free (&dead);
 		} else {
 			/* It's a big block.  Free its pages. */
+			__atomic_sub_fetch (&big_page_cnt, a->free_cnt, __ATOMIC_RELAXED);
 			palloc_free_multiple (a, a->free_cnt);
 			return;
 		}
 	}
 }
-
+
+/* Returns the number of pages malloc() currently holds, in arenas
+   and big blocks. */
+size_t
+malloc_page_cnt (void) {
+	size_t page_cnt = __atomic_load_n (&big_page_cnt, __ATOMIC_RELAXED);
+	struct desc *d;
+
+	for (d = descs; d < descs + DESC_CNT; d++)
+		page_cnt += d->arena_cnt * d->arena_pages;
+	return page_cnt;
+}
+
+/* Returns the blocks held in magazines to the depot, which gives
+   every arena left with no block in use back to the page
+   allocator. */
+void
+malloc_flush (void) {
+	enum intr_level old_level;
+	struct list dead;
+
+	list_init (&dead);
+	old_level = intr_disable ();
+	mag_flush (&dead);
+	intr_set_level (old_level);
+	arenas_free (&dead);
+}
+
+/* Prints the pages malloc() holds and, for each block size in
+   use, the arenas allocated and how many times a magazine had to
+   go to the depot. */
+void
+malloc_print_stats (void) {
+	struct desc *d;
+
+	printf ("malloc: %zu pages, %zu in big blocks;", malloc_page_cnt (),
+			__atomic_load_n (&big_page_cnt, __ATOMIC_RELAXED));
+	for (d = descs; d < descs + DESC_CNT; d++)
+		if (d->depot_cnt > 0)
+			printf (" %zu:%zu/%llu", d->block_size, d->arena_cnt,
+					(unsigned long long) d->depot_cnt);
+	printf (" (size:arenas/depot trips)\n");
+}
+
+/* Returns the block size of size class IDX. */
+static size_t
+class_size (size_t idx) {
+	size_t shift;
+
+	if (idx < CLASS_STEPS)
+		return CLASS_MIN * (idx + 1);
+	shift = idx / CLASS_STEPS - 1;
+	return ((CLASS_MIN * CLASS_STEPS) << shift)
+		+ (idx % CLASS_STEPS + 1) * (CLASS_MIN << shift);
+}
+
+/* Returns the descriptor of the smallest size class that holds
+   SIZE bytes, or a null pointer if SIZE is bigger than CLASS_MAX.
+   This is the inverse of class_size(), computed directly so that
+   malloc() does not have to search the table. */
+static struct desc *
+size_to_desc (size_t size) {
+	size_t idx;
+	int log;
+
+	ASSERT (size > 0);
+
+	if (size > CLASS_MAX)
+		return NULL;
+	if (size <= CLASS_MIN * CLASS_STEPS)
+		return &descs[(size - 1) / CLASS_MIN];
+
+	/* 2**LOG < SIZE <= 2**(LOG + 1), with LOG >= 7.  The classes
+	   in that range are 2**LOG / CLASS_STEPS apart. */
+	log = 63 - __builtin_clzll (size - 1);
+	idx = CLASS_STEPS * (log - 6)
+		+ ((size - 1 - ((size_t) 1 << log)) >> (log - 3));
+	return &descs[idx];
+}
+
+/* Chooses the arena size and block layout for D.  Classes up to
+   PAGE_CLASS_MAX get one-page arenas.  Larger classes get the
+   number of pages, up to ARENA_PAGES_MAX, that leaves the
+   smallest share of the arena unused. */
+static void
+arena_layout (struct desc *d) {
+	size_t pages, best_waste = 0;
+
+	if (!HAS_HDR (d)) {
+		d->block_stride = d->block_size;
+		d->block_ofs = sizeof (struct arena);
+		d->arena_pages = 1;
+		d->blocks_per_arena = (PGSIZE - d->block_ofs) / d->block_stride;
+		return;
+	}
+
+	d->block_stride = d->block_size + sizeof (struct block_hdr);
+	d->block_ofs = ROUND_UP (sizeof (struct arena), 16) + sizeof (struct block_hdr);
+	d->arena_pages = 0;
+	for (pages = 1; pages <= ARENA_PAGES_MAX; pages++) {
+		size_t arena_size = pages * PGSIZE;
+		size_t cnt = (arena_size - d->block_ofs + sizeof (struct block_hdr))
+			/ d->block_stride;
+		size_t waste = arena_size - cnt * d->block_size;
+
+		/* Compare WASTE / ARENA_SIZE with the best so far. */
+		if (cnt > 0 && (d->arena_pages == 0
+					|| waste * d->arena_pages < best_waste * pages)) {
+			d->arena_pages = pages;
+			d->blocks_per_arena = cnt;
+			best_waste = waste;
+		}
+	}
+	ASSERT (d->arena_pages > 0);
+}
+
+/* Initializes A, a new arena of D's size just obtained from the
+   page allocator.  A is not yet visible to anyone else, so
+   interrupts may be on. */
+static void
+arena_init (struct desc *d, struct arena *a) {
+	size_t i;
+
+	a->magic = ARENA_MAGIC;
+	a->desc = d;
+	a->free_cnt = d->blocks_per_arena;
+	if (HAS_HDR (d))
+		for (i = 0; i < d->blocks_per_arena; i++)
+			((struct block_hdr *) arena_to_block (a, i) - 1)->arena = a;
+}
+
+/* Gives the arenas on DEAD, which depot_put() took out of the
+   depot, back to the page allocator.  Interrupts should be on. */
+static void
+arenas_free (struct list *dead) {
+	while (!list_empty (dead)) {
+		struct block *b = list_entry (list_pop_front (dead),
+				struct block, free_elem);
+		struct arena *a = block_to_arena (b);
+
+		palloc_free_multiple (a, a->desc->arena_pages);
+	}
+}
+
+/* Returns the magazine for D.  Interrupts must be off, so that
+   no other thread uses it at the same time. */
+static struct magazine *
+mag_current (struct desc *d) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	return &mags[d - descs];
+}
+
+/* Fills half of empty magazine M with blocks from D's depot.
+   Returns false if the depot had no block at all. */
+static bool
+mag_refill (struct desc *d, struct magazine *m) {
+	ASSERT (m->cnt == 0);
+
+	d->depot_cnt++;
+	while (m->cnt < d->mag_rounds / 2) {
+		struct block *b = depot_get (d);
+		if (b == NULL)
+			break;
+		m->rounds[m->cnt++] = b;
+	}
+	return m->cnt > 0;
+}
+
+/* Returns the top CNT blocks of magazine M to D's depot.  Arenas
+   left unused are added to DEAD. */
+static void
+mag_drain (struct desc *d, struct magazine *m, size_t cnt,
+		struct list *dead) {
+	ASSERT (cnt <= m->cnt);
+
+	d->depot_cnt++;
+	while (cnt-- > 0)
+		depot_put (d, m->rounds[--m->cnt], dead);
+}
+
+/* Empties all the magazines into the depot.  Arenas left unused
+   are added to DEAD. */
+static void
+mag_flush (struct list *dead) {
+	struct desc *d;
+
+	for (d = descs; d < descs + DESC_CNT; d++) {
+		struct magazine *m = mag_current (d);
+		if (m->cnt > 0)
+			mag_drain (d, m, m->cnt, dead);
+	}
+}
+
+/* Takes a free block from D's depot.  Returns a null pointer if
+   the depot is empty.  Interrupts must be off. */
+static struct block *
+depot_get (struct desc *d) {
+	struct block *b;
+	struct arena *a;
+
+	if (list_empty (&d->free_list))
+		return NULL;
+
+	/* Get a block from free list and return it. */
+	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
+	a = block_to_arena (b);
+	a->free_cnt--;
+	return b;
+}
+
+/* Returns block B to D's depot.  If that leaves its arena
+   unused, takes the arena out of the depot and adds it to DEAD
+   for arenas_free().  Interrupts must be off. */
+static void
+depot_put (struct desc *d, struct block *b, struct list *dead) {
+	struct arena *a = block_to_arena (b);
+
+	/* Add block to free list. */
+	list_push_front (&d->free_list, &b->free_elem);
+
+	/* If the arena is now entirely unused, free it. */
+	if (++a->free_cnt >= d->blocks_per_arena) {
+		size_t i;
+
+		ASSERT (a->free_cnt == d->blocks_per_arena);
+		for (i = 0; i < d->blocks_per_arena; i++) {
+			struct block *b = arena_to_block (a, i);
+			list_remove (&b->free_elem);
+		}
+		list_push_back (dead, &arena_to_block (a, 0)->free_elem);
+		d->arena_cnt--;
+	}
+}
+
+/* Adds the blocks of A, a new arena initialized by arena_init(),
+   to D's depot.  Interrupts must be off. */
+static void
+depot_add (struct desc *d, struct arena *a) {
+	size_t i;
+
+	for (i = 0; i < d->blocks_per_arena; i++)
+		list_push_back (&d->free_list, &arena_to_block (a, i)->free_elem);
+	d->arena_cnt++;
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b) {
-	struct arena *a = pg_round_down (b);
+	struct arena *a;
+
+	if (IN_PAGE_ARENA (b))
+		a = pg_round_down (b);
+	else
+		a = ((struct block_hdr *) b - 1)->arena;
 
 	/* Check that the arena is valid. */
 	ASSERT (a != NULL);
@@ -250,8 +612,12 @@ block_to_arena (struct block *b) {
 
 	/* Check that the block is properly aligned for the arena. */
 	ASSERT (a->desc == NULL
-			|| (pg_ofs (b) - sizeof *a) % a->desc->block_size == 0);
+			|| ((uint8_t *) b - (uint8_t *) a - a->desc->block_ofs)
+			   % a->desc->block_stride == 0);
+	ASSERT (a->desc == NULL
+			|| (uint8_t *) b < (uint8_t *) a + a->desc->arena_pages * PGSIZE);
 	ASSERT (a->desc != NULL || pg_ofs (b) == sizeof *a);
+	ASSERT ((a->desc != NULL && HAS_HDR (a->desc)) != IN_PAGE_ARENA (b));
 
 	return a;
 }
@@ -263,6 +629,6 @@ arena_to_block (struct arena *a, size_t idx) {
 	ASSERT (a->magic == ARENA_MAGIC);
 	ASSERT (idx < a->desc->blocks_per_arena);
 	return (struct block *) ((uint8_t *) a
-			+ sizeof *a
-			+ idx * a->desc->block_size);
+			+ a->desc->block_ofs
+			+ idx * a->desc->block_stride);
 }
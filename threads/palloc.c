@@ -2,12 +2,14 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -24,13 +26,35 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
-
-/* A memory pool. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Within a pool, free pages are managed by a binary buddy
+   allocator.  Free memory is kept as blocks of 2**ORDER pages,
+   aligned to their size relative to the pool base, on one free
+   list per order.  An allocation of N pages takes the smallest
+   block that fits, splitting larger blocks as needed, and returns
+   the unused tail pages to the free lists, so requests that are
+   not a power of two waste nothing.  A freed block merges with
+   its buddy for as long as the buddy is also free.  Both take
+   O(log n) list operations instead of a scan of the pool.
+
+   used_map still records which pages are allocated, which lets
+   palloc_free_multiple() catch double frees. */
+
+/* Largest block order.  Requests for more than 2**BUDDY_MAX_ORDER
+   pages fail. */
+#define BUDDY_MAX_ORDER 12
+
+/* A memory pool.  Pages are freed from do_schedule() with
+   interrupts off, where a sleeping lock must not block, so the
+   members below are only touched with interrupts disabled. */
 struct pool {
-	struct lock lock;               /* Mutual exclusion. */
 	struct bitmap *used_map;        /* Bitmap of free pages. */
 	uint8_t *base;                  /* Base of pool. */
+	uint8_t *orders;                /* Per page: order + 1 if the page
+	                                   heads a free block, else 0. */
+	struct list free[BUDDY_MAX_ORDER + 1]; /* Free blocks by order. */
+	size_t free_cnt;                /* Number of free pages. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -42,6 +66,9 @@ static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static void buddy_init (struct pool *);
+static size_t buddy_alloc (struct pool *, size_t page_cnt);
+static void buddy_free (struct pool *, size_t page_idx, size_t page_cnt);
 
 /* multiboot info */
 struct multiboot_info {
@@ -88,7 +115,6 @@ resolve_area_info (struct area *base_mem, struct area *ext_mem) {
 			uint64_t start = APPEND_HILO (entry->mem_hi, entry->mem_lo);
 			uint64_t size = APPEND_HILO (entry->len_hi, entry->len_lo);
 			uint64_t end = start + size;
-			printf("%llx ~ %llx %d\n", start, end, entry->type);
 
 			struct area *area = start < BASE_MEM_THRESHOLD ? base_mem : ext_mem;
 
@@ -250,6 +276,8 @@ palloc_init (void) {
 	printf ("\text_mem: 0x%llx ~ 0x%llx (Usable: %'llu kB)\n",
 		  ext_mem.start, ext_mem.end, ext_mem.size / 1024);
 	populate_pools (&base_mem, &ext_mem);
+	buddy_init (&kernel_pool);
+	buddy_init (&user_pool);
 	return ext_mem.end;
 }
 
@@ -262,12 +290,16 @@ palloc_init (void) {
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
-
-	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
+	enum intr_level old_level;
+	size_t page_idx;
 	void *pages;
 
+	old_level = intr_disable ();
+	page_idx = buddy_alloc (pool, page_cnt);
+	if (page_idx != BITMAP_ERROR)
+		bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+	intr_set_level (old_level);
+
 	if (page_idx != BITMAP_ERROR)
 		pages = pool->base + PGSIZE * page_idx;
 	else
@@ -299,6 +331,7 @@ palloc_get_page (enum palloc_flags flags) {
 /* Frees the PAGE_CNT pages starting at PAGES. */
 void
 palloc_free_multiple (void *pages, size_t page_cnt) {
+	enum intr_level old_level;
 	struct pool *pool;
 	size_t page_idx;
 
@@ -318,8 +351,11 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 #ifndef NDEBUG
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
+	old_level = intr_disable ();
 	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
 	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	buddy_free (pool, page_idx, page_cnt);
+	intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -335,10 +371,11 @@ init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
      Calculate the space needed for the bitmap
      and subtract it from the pool's size. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
-	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
+	size_t bm_size = bitmap_buf_size (pgcnt);
+	size_t bm_pages = DIV_ROUND_UP (bm_size + pgcnt, PGSIZE) * PGSIZE;
 
-	lock_init(&p->lock);
-	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
+	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_size);
+	p->orders = (uint8_t *) *bm_base + bm_size;
 	p->base = (void *) start;
 
 	// Mark all to unusable.
@@ -356,3 +393,151 @@ page_from_pool (const struct pool *pool, void *page) {
 	size_t end_page = start_page + bitmap_size (pool->used_map);
 	return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns the free block of pages starting at PAGE_IDX in POOL. */
+static inline struct list_elem *
+block_elem (const struct pool *pool, size_t page_idx) {
+	return (struct list_elem *) (pool->base + page_idx * PGSIZE);
+}
+
+/* Returns the index of the page whose free block elem is E. */
+static inline size_t
+block_idx (const struct pool *pool, struct list_elem *e) {
+	return pg_no (e) - pg_no (pool->base);
+}
+
+/* Returns the smallest order whose blocks hold PAGE_CNT pages. */
+static inline int
+order_for (size_t page_cnt) {
+	return page_cnt <= 1 ? 0 : 64 - __builtin_clzll (page_cnt - 1);
+}
+
+/* Builds POOL's free lists from the free pages in its used_map,
+   which populate_pools() has filled in. */
+static void
+buddy_init (struct pool *pool) {
+	size_t pgcnt = bitmap_size (pool->used_map);
+	size_t start = 0;
+	int i;
+
+	for (i = 0; i <= BUDDY_MAX_ORDER; i++)
+		list_init (&pool->free[i]);
+	memset (pool->orders, 0, pgcnt);
+	pool->free_cnt = 0;
+
+	while ((start = bitmap_scan (pool->used_map, start, 1, false)) != BITMAP_ERROR) {
+		size_t end = bitmap_scan (pool->used_map, start, 1, true);
+
+		if (end == BITMAP_ERROR)
+			end = pgcnt;
+		buddy_free (pool, start, end - start);
+		start = end;
+	}
+}
+
+/* Puts the free block of 2**ORDER pages at PAGE_IDX on POOL's free
+   lists, first merging it with its buddy as many times as
+   possible. */
+static void
+buddy_free_block (struct pool *pool, size_t page_idx, int order) {
+	size_t pgcnt = bitmap_size (pool->used_map);
+
+	pool->free_cnt += (size_t) 1 << order;
+	while (order < BUDDY_MAX_ORDER) {
+		size_t buddy = page_idx ^ ((size_t) 1 << order);
+
+		if (buddy + ((size_t) 1 << order) > pgcnt
+				|| pool->orders[buddy] != order + 1)
+			break;
+		list_remove (block_elem (pool, buddy));
+		pool->orders[buddy] = 0;
+		page_idx &= ~((size_t) 1 << order);
+		order++;
+	}
+	pool->orders[page_idx] = order + 1;
+	list_push_front (&pool->free[order], block_elem (pool, page_idx));
+}
+
+/* Returns the PAGE_CNT pages at PAGE_IDX to POOL, as the largest
+   aligned blocks they can be split into. */
+static void
+buddy_free (struct pool *pool, size_t page_idx, size_t page_cnt) {
+	while (page_cnt > 0) {
+		int order = page_idx == 0 ? BUDDY_MAX_ORDER : __builtin_ctzll (page_idx);
+
+		if (order > BUDDY_MAX_ORDER)
+			order = BUDDY_MAX_ORDER;
+		while (((size_t) 1 << order) > page_cnt)
+			order--;
+		buddy_free_block (pool, page_idx, order);
+		page_idx += (size_t) 1 << order;
+		page_cnt -= (size_t) 1 << order;
+	}
+}
+
+/* Takes PAGE_CNT contiguous pages from POOL and returns the index
+   of the first, or BITMAP_ERROR if no free block is big enough. */
+static size_t
+buddy_alloc (struct pool *pool, size_t page_cnt) {
+	int want = order_for (page_cnt);
+	int order;
+	size_t page_idx;
+
+	if (page_cnt == 0 || want > BUDDY_MAX_ORDER)
+		return BITMAP_ERROR;
+	for (order = want; order <= BUDDY_MAX_ORDER; order++)
+		if (!list_empty (&pool->free[order]))
+			break;
+	if (order > BUDDY_MAX_ORDER)
+		return BITMAP_ERROR;
+
+	page_idx = block_idx (pool, list_pop_front (&pool->free[order]));
+	pool->orders[page_idx] = 0;
+	pool->free_cnt -= (size_t) 1 << order;
+
+	/* Split off the upper halves until the block is just big
+	   enough, then give back the tail that was not asked for. */
+	while (order > want) {
+		order--;
+		buddy_free_block (pool, page_idx + ((size_t) 1 << order), order);
+	}
+	if (page_cnt < ((size_t) 1 << order))
+		buddy_free (pool, page_idx + page_cnt, ((size_t) 1 << order) - page_cnt);
+	return page_idx;
+}
+
+/* Prints free block counts by order for POOL, named NAME, and how
+   fragmented its free memory is: the share of free pages that are
+   not in the largest free block. */
+static void
+print_pool_stats (struct pool *pool, const char *name) {
+	size_t counts[BUDDY_MAX_ORDER + 1];
+	enum intr_level old_level;
+	size_t free_cnt, largest = 0;
+	int i;
+
+	old_level = intr_disable ();
+	for (i = 0; i <= BUDDY_MAX_ORDER; i++) {
+		counts[i] = list_size (&pool->free[i]);
+		if (counts[i] > 0)
+			largest = (size_t) 1 << i;
+	}
+	free_cnt = pool->free_cnt;
+	intr_set_level (old_level);
+
+	printf ("  %-6s %6zu of %6zu pages free, largest block %zu, "
+			"fragmentation %zu%%\n  %6s", name, free_cnt,
+			bitmap_size (pool->used_map), largest,
+			free_cnt > 0 ? (free_cnt - largest) * 100 / free_cnt : 0, "");
+	for (i = 0; i <= BUDDY_MAX_ORDER; i++)
+		printf (" %zu", counts[i]);
+	printf (" free blocks by order\n");
+}
+
+/* Prints page pool usage and fragmentation. */
+void
+palloc_print_stats (void) {
+	printf ("Page pools:\n");
+	print_pool_stats (&kernel_pool, "kernel");
+	print_pool_stats (&user_pool, "user");
+}
@@ -0,0 +1,277 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Each slab is one page.  A struct slab header sits at the start
+   of the page, followed by an array of free-list links, one per
+   object, and then the objects themselves:
+
+      +--------+-------------+-------+-----+-----+- ... -+-----+
+      | header | next[0..n)  | color | obj | obj |       | obj |
+      +--------+-------------+-------+-----+-----+- ... -+-----+
+
+   Keeping the links outside the objects leaves free objects in
+   their constructed state.  kmem_cache_free() finds the slab of
+   an object by rounding its address down to the page. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Object alignment and coloring step. */
+#define OBJ_ALIGN 8
+#define CACHE_LINE 64
+
+/* End of a slab's free list. */
+#define SLAB_END UINT16_MAX
+
+/* Slab header. */
+struct slab {
+	unsigned magic;             /* Always set to SLAB_MAGIC. */
+	struct kmem_cache *cache;   /* Owning cache. */
+	struct list_elem elem;      /* Element in one of the cache's lists. */
+	uint8_t *objs;              /* First object. */
+	size_t used_cnt;            /* Objects allocated. */
+	uint16_t free_head;         /* First free object, or SLAB_END. */
+	uint16_t next[];            /* Next free object after each one. */
+};
+
+/* All caches, for statistics. */
+static struct list caches;
+static struct lock caches_lock;
+
+static struct slab *slab_create (struct kmem_cache *);
+static struct slab *obj_to_slab (struct kmem_cache *, void *);
+
+/* Initializes the object cache subsystem.  Must be called before
+   any cache is created. */
+void
+kmem_init (void) {
+	list_init (&caches);
+	lock_init (&caches_lock);
+}
+
+/* Initializes CACHE to hand out objects of SIZE bytes, calling
+   CTOR, if nonnull, on each one when its slab is created.  NAME
+   identifies the cache in kmem_print_stats(). */
+void
+kmem_cache_create (struct kmem_cache *cache, const char *name, size_t size,
+                   kmem_ctor_func *ctor) {
+	size_t obj_size = ROUND_UP (size, OBJ_ALIGN);
+	size_t obj_cnt, obj_ofs;
+
+	ASSERT (cache != NULL);
+	ASSERT (size > 0);
+
+	/* Fit as many objects as possible along with their links. */
+	obj_cnt = (PGSIZE - sizeof (struct slab)) / (obj_size + sizeof (uint16_t));
+	for (;;) {
+		obj_ofs = ROUND_UP (sizeof (struct slab) + obj_cnt * sizeof (uint16_t),
+				OBJ_ALIGN);
+		if (obj_ofs + obj_cnt * obj_size <= PGSIZE)
+			break;
+		obj_cnt--;
+	}
+	if (obj_cnt > SLAB_END)
+		obj_cnt = SLAB_END;
+	ASSERT (obj_cnt > 0);
+
+	cache->name = name;
+	cache->obj_size = obj_size;
+	cache->obj_cnt = obj_cnt;
+	cache->obj_ofs = obj_ofs;
+	cache->color_max = ROUND_DOWN (PGSIZE - obj_ofs - obj_cnt * obj_size,
+			CACHE_LINE);
+	cache->color_next = 0;
+	cache->ctor = ctor;
+
+	lock_init (&cache->lock);
+	list_init (&cache->partial);
+	list_init (&cache->full);
+	list_init (&cache->empty);
+	cache->slab_cnt = 0;
+	cache->active_cnt = 0;
+	cache->active_max = 0;
+	cache->alloc_cnt = 0;
+
+	lock_acquire (&caches_lock);
+	list_push_back (&caches, &cache->elem);
+	lock_release (&caches_lock);
+}
+
+/* Allocates an object from CACHE and returns it, or a null
+   pointer if memory is not available.  The object is in the
+   state the constructor left it, or in the state it was freed
+   in; it is not cleared. */
+void *
+kmem_cache_alloc (struct kmem_cache *cache) {
+	struct slab *slab;
+	void *obj;
+	size_t idx;
+
+	ASSERT (cache != NULL);
+
+	lock_acquire (&cache->lock);
+	if (list_empty (&cache->partial)) {
+		if (!list_empty (&cache->empty))
+			list_push_back (&cache->partial, list_pop_front (&cache->empty));
+		else {
+			/* Run the constructors without holding the lock. */
+			lock_release (&cache->lock);
+			slab = slab_create (cache);
+			if (slab == NULL)
+				return NULL;
+			lock_acquire (&cache->lock);
+			cache->slab_cnt++;
+			list_push_back (&cache->partial, &slab->elem);
+		}
+	}
+
+	slab = list_entry (list_front (&cache->partial), struct slab, elem);
+	idx = slab->free_head;
+	ASSERT (idx != SLAB_END);
+	slab->free_head = slab->next[idx];
+	if (++slab->used_cnt == cache->obj_cnt) {
+		list_remove (&slab->elem);
+		list_push_back (&cache->full, &slab->elem);
+	}
+	obj = slab->objs + idx * cache->obj_size;
+
+	cache->alloc_cnt++;
+	if (++cache->active_cnt > cache->active_max)
+		cache->active_max = cache->active_cnt;
+	lock_release (&cache->lock);
+	return obj;
+}
+
+/* Allocates an object from CACHE, which must not have a
+   constructor, and fills it with zeros.  Returns a null pointer
+   if memory is not available. */
+void *
+kmem_cache_zalloc (struct kmem_cache *cache) {
+	void *obj;
+
+	ASSERT (cache->ctor == NULL);
+
+	obj = kmem_cache_alloc (cache);
+	if (obj != NULL)
+		memset (obj, 0, cache->obj_size);
+	return obj;
+}
+
+/* Returns OBJ, which must have been allocated from CACHE, to
+   CACHE.  A null OBJ is ignored. */
+void
+kmem_cache_free (struct kmem_cache *cache, void *obj) {
+	struct slab *slab, *release = NULL;
+	size_t idx;
+
+	if (obj == NULL)
+		return;
+
+	slab = obj_to_slab (cache, obj);
+	idx = ((uint8_t *) obj - slab->objs) / cache->obj_size;
+
+#ifndef NDEBUG
+	/* Clear the object to help detect use-after-free bugs, unless
+	   it has to stay constructed. */
+	if (cache->ctor == NULL)
+		memset (obj, 0xcc, cache->obj_size);
+#endif
+
+	lock_acquire (&cache->lock);
+	ASSERT (slab->used_cnt > 0);
+	if (slab->used_cnt-- == cache->obj_cnt) {
+		list_remove (&slab->elem);
+		list_push_back (&cache->partial, &slab->elem);
+	}
+	slab->next[idx] = slab->free_head;
+	slab->free_head = idx;
+
+	/* Keep one empty slab around so that a cache whose usage
+	   hovers around a slab boundary does not churn pages. */
+	if (slab->used_cnt == 0) {
+		list_remove (&slab->elem);
+		if (list_empty (&cache->empty))
+			list_push_back (&cache->empty, &slab->elem);
+		else {
+			release = slab;
+			cache->slab_cnt--;
+		}
+	}
+	cache->active_cnt--;
+	lock_release (&cache->lock);
+
+	if (release != NULL)
+		palloc_free_page (release);
+}
+
+/* Prints usage of every cache: objects in use and their peak,
+   slabs, and how much of the slabs' memory holds live objects. */
+void
+kmem_print_stats (void) {
+	struct list_elem *e;
+
+	printf ("Slab caches:\n");
+	printf ("  %-16s %6s %6s %8s %8s %6s %10s %6s\n", "name", "size",
+			"/slab", "active", "peak", "slabs", "allocs", "used");
+	lock_acquire (&caches_lock);
+	for (e = list_begin (&caches); e != list_end (&caches); e = list_next (e)) {
+		struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+		size_t bytes = c->slab_cnt * PGSIZE;
+
+		printf ("  %-16s %6zu %6zu %8zu %8zu %6zu %10llu %5zu%%\n", c->name,
+				c->obj_size, c->obj_cnt, c->active_cnt, c->active_max,
+				c->slab_cnt, (unsigned long long) c->alloc_cnt,
+				bytes > 0 ? c->active_cnt * c->obj_size * 100 / bytes : 0);
+	}
+	lock_release (&caches_lock);
+}
+
+/* Allocates a new slab for CACHE, with every object constructed
+   and on its free list.  Returns a null pointer if no page is
+   available. */
+static struct slab *
+slab_create (struct kmem_cache *cache) {
+	struct slab *slab = palloc_get_page (0);
+	size_t color, i;
+
+	if (slab == NULL)
+		return NULL;
+
+	lock_acquire (&cache->lock);
+	color = cache->color_next;
+	cache->color_next = color < cache->color_max ? color + CACHE_LINE : 0;
+	lock_release (&cache->lock);
+
+	slab->magic = SLAB_MAGIC;
+	slab->cache = cache;
+	slab->objs = (uint8_t *) slab + cache->obj_ofs + color;
+	slab->used_cnt = 0;
+	slab->free_head = 0;
+	for (i = 0; i < cache->obj_cnt; i++) {
+		slab->next[i] = i + 1 < cache->obj_cnt ? i + 1 : SLAB_END;
+		if (cache->ctor != NULL)
+			cache->ctor (slab->objs + i * cache->obj_size);
+	}
+	return slab;
+}
+
+/* Returns the slab of CACHE that OBJ is in. */
+static struct slab *
+obj_to_slab (struct kmem_cache *cache, void *obj) {
+	struct slab *slab = pg_round_down (obj);
+
+	/* Check that the slab is valid and belongs to CACHE. */
+	ASSERT (slab->magic == SLAB_MAGIC);
+	ASSERT (slab->cache == cache);
+
+	/* Check that OBJ is properly aligned for the slab. */
+	ASSERT ((uint8_t *) obj >= slab->objs);
+	ASSERT (((uint8_t *) obj - slab->objs) % cache->obj_size == 0);
+
+	return slab;
+}
@@ -30,12 +30,54 @@
 
 #include "threads/synch.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include "intrinsic.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
-bool cmp_sem_priority(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED);
+/* Number of entries printed by lock_print_stats(), or 0 if lock
+   profiling is off.  Set by the "-lockstat" kernel option, which
+   is parsed before any lock is initialized. */
+int lockstat_top;
+
+/* Contention counters shared by all locks with the same name.
+   All times are in TSC cycles. */
+struct lock_stat {
+	const char *name;           /* Name given to lock_init(). */
+	uint64_t acquired;          /* Successful acquisitions. */
+	uint64_t contended;         /* Acquisitions that had to wait. */
+	uint64_t wait_total;        /* Cycles spent waiting. */
+	uint64_t wait_max;          /* Longest single wait. */
+	uint64_t hold_total;        /* Cycles between acquire and release. */
+	uint64_t hold_max;          /* Longest single hold. */
+};
 
+/* Lock classes seen so far.  Locks are freed with their owners
+   (inodes, threads, ...) so the counters live here, not in the
+   lock itself; names beyond LOCK_STAT_CNT share the last slot. */
+#define LOCK_STAT_CNT 128
+static struct lock_stat lock_stats[LOCK_STAT_CNT];
+static size_t lock_stat_cnt;
+
+static struct lock_stat *lock_stat_lookup (const char *name);
+static void lock_wait (struct lock *, bool contended, uint64_t start);
+
+/* Sequence number stamped on each waiter so that waiters of
+   equal priority are woken in FIFO order. */
+static uint64_t wait_seq;
+
+/* Orders semaphore waiters by priority, then by arrival. */
+static bool
+sema_waiter_less (const struct heap_elem *a_, const struct heap_elem *b_,
+                  void *aux UNUSED) {
+	const struct thread *a = heap_entry (a_, struct thread, wait_elem);
+	const struct thread *b = heap_entry (b_, struct thread, wait_elem);
+
+	if (a->priority != b->priority)
+		return a->priority < b->priority;
+	return a->wait_seq > b->wait_seq;
+}
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -51,7 +93,7 @@ sema_init (struct semaphore *sema, unsigned value) {
 	ASSERT (sema != NULL);
 
 	sema->value = value;
-	list_init (&sema->waiters);
+	heap_init (&sema->waiters, sema_waiter_less, NULL);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -71,9 +113,11 @@ sema_down (struct semaphore *sema) {
 
 	old_level = intr_disable ();
 	while (sema->value == 0) {
-		// list_push_back (&sema->waiters, &thread_current ()->elem);
-		list_insert_ordered(&sema->waiters, &thread_current()->elem, 
-                        cmp_priority, NULL);
+		struct thread *t = thread_current ();
+
+		t->wait_seq = wait_seq++;
+		t->wait_heap = &sema->waiters;
+		heap_insert (&sema->waiters, &t->wait_elem);
 		thread_block ();
 	}
 	sema->value--;
@@ -116,10 +160,13 @@ sema_up (struct semaphore *sema) {
 	ASSERT (sema != NULL);
  
 	old_level = intr_disable ();
-	if (!list_empty (&sema->waiters)){
-		/* 세마포어 대기자 목록을 정렬한다. */
-		list_sort(&sema->waiters, cmp_priority, NULL);
-        thread_unblock(list_entry(list_pop_front(&sema->waiters), struct thread, elem));
+	if (!heap_empty (&sema->waiters)) {
+		/* 기부로 바뀐 우선순위는 thread_update_priority()가 이미
+		   힙에 반영했으므로 top이 곧 가장 높은 우선순위다. */
+		struct thread *t = heap_entry (heap_pop (&sema->waiters),
+		                               struct thread, wait_elem);
+		t->wait_heap = NULL;
+		thread_unblock (t);
 	}
 	sema->value++;
 	/* 우선순위를 비교해 더 높은 우선순위를 가진 스레드에게 스레드를 넘긴다. */
@@ -176,13 +223,111 @@ sema_test_helper (void *sema_) {
    another one "up" it, but with a lock the same thread must both
    acquire and release it.  When these restrictions prove
    onerous, it's a good sign that a semaphore should be used,
-   instead of a lock. */
+   instead of a lock.
+
+   NAME identifies the lock in the contention report; the
+   lock_init() macro passes the source text of its argument.  It
+   must outlive the lock, which a string literal always does. */
 void
-lock_init (struct lock *lock) {
+lock_init_named (struct lock *lock, const char *name) {
 	ASSERT (lock != NULL);
+	ASSERT (name != NULL);
 
 	lock->holder = NULL;
 	sema_init (&lock->semaphore, 1);
+	heap_init (&lock->waiters, cmp_waiter_priority, NULL);
+	lock->stat = lockstat_top > 0 ? lock_stat_lookup (name) : NULL;
+	lock->acquired_tsc = 0;
+}
+
+/* Returns the counters for locks named NAME, creating them on
+   first use. */
+static struct lock_stat *
+lock_stat_lookup (const char *name) {
+	enum intr_level old_level;
+	struct lock_stat *ls;
+	size_t i;
+
+	old_level = intr_disable ();
+	for (i = 0; i < lock_stat_cnt; i++) {
+		ls = &lock_stats[i];
+		if (ls->name == name || !strcmp (ls->name, name))
+			goto done;
+	}
+	if (lock_stat_cnt < LOCK_STAT_CNT) {
+		ls = &lock_stats[lock_stat_cnt++];
+		ls->name = name;
+	} else {
+		ls = &lock_stats[LOCK_STAT_CNT - 1];
+		ls->name = "(other)";
+	}
+done:
+	intr_set_level (old_level);
+	return ls;
+}
+
+/* Orders lock classes by total wait, longest first. */
+static int
+lock_stat_compare (const void *a_, const void *b_, void *aux UNUSED) {
+	const struct lock_stat *a = *(struct lock_stat *const *) a_;
+	const struct lock_stat *b = *(struct lock_stat *const *) b_;
+
+	if (a->wait_total != b->wait_total)
+		return a->wait_total < b->wait_total ? 1 : -1;
+	return a->contended < b->contended ? 1 : a->contended > b->contended ? -1 : 0;
+}
+
+/* Prints the lockstat_top lock classes with the most time spent
+   waiting, if lock profiling is on.  Sorts pointers rather than
+   the counters themselves, which live locks still point to. */
+void
+lock_print_stats (void) {
+	static struct lock_stat *sorted[LOCK_STAT_CNT];
+	enum intr_level old_level;
+	size_t i, cnt;
+
+	if (lockstat_top <= 0)
+		return;
+
+	old_level = intr_disable ();
+	cnt = lock_stat_cnt;
+	for (i = 0; i < cnt; i++)
+		sorted[i] = &lock_stats[i];
+	intr_set_level (old_level);
+
+	sort (sorted, cnt, sizeof *sorted, lock_stat_compare, NULL);
+	printf ("Lock contention (top %d of %zu, TSC cycles):\n",
+			lockstat_top, cnt);
+	printf ("  %-24s %10s %10s %14s %12s %12s %12s\n", "name", "acquired",
+			"contended", "wait total", "wait max", "hold avg", "hold max");
+	for (i = 0; i < cnt && i < (size_t) lockstat_top; i++) {
+		const struct lock_stat *ls = sorted[i];
+		printf ("  %-24s %10llu %10llu %14llu %12llu %12llu %12llu\n",
+				ls->name, ls->acquired, ls->contended, ls->wait_total,
+				ls->wait_max, ls->acquired ? ls->hold_total / ls->acquired : 0,
+				ls->hold_max);
+	}
+}
+
+/* Makes the current thread the holder of LOCK, which it has just
+   downed.  Outside MLFQS the lock also joins the thread's
+   held_locks heap, so any threads still waiting on it donate to
+   the new holder.  Interrupts must be off. */
+static void
+lock_set_holder (struct lock *lock) {
+	struct thread *t = thread_current ();
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	lock->holder = t;
+	if (lock->stat != NULL) {
+		lock->acquired_tsc = rdtsc ();
+		lock->stat->acquired++;
+	}
+	if (sched_class->donation) {
+		heap_insert (&t->held_locks, &lock->elem);
+		refresh_priority ();
+	}
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -200,21 +345,49 @@ lock_acquire (struct lock *lock) {
 	ASSERT (!lock_held_by_current_thread (lock));
 
 	struct thread *t = thread_current();
+	enum intr_level old_level = intr_disable ();
+	bool contended = lock->holder != NULL;
+	uint64_t start = lock->stat != NULL && contended ? rdtsc () : 0;
+
 	// MLFQ 모드가 아닐 때만 우선순위 기부 로직 실행
-    if (!thread_mlfqs && lock->holder != NULL) {
-        t->wait_on_lock = lock;
-        list_push_back(&lock->holder->donations, &t->donations_elem);
-        donation_priority();
-    }
+	// MLFQ 는 우선순위 기부가 일어나지 않는다.
+	if (sched_class->donation && contended) {
+		t->wait_on_lock = lock;
+		heap_insert (&lock->waiters, &t->lock_elem);
+		donation_priority ();
+	}
+
+	lock_wait (lock, contended, start);
+	intr_set_level (old_level);
+}
+
+/* Second half of lock_acquire(): downs LOCK's semaphore and makes
+   the current thread its holder.  Also entered by a condition
+   waiter that cond_signal() moved straight onto LOCK's queue, in
+   which case the current thread may already have been woken by
+   the lock_release() that handed LOCK over.  CONTENDED and START
+   feed the contention profile.  Interrupts must be off. */
+static void
+lock_wait (struct lock *lock, bool contended, uint64_t start) {
+	struct thread *t = thread_current ();
+
+	ASSERT (intr_get_level () == INTR_OFF);
 
 	sema_down (&lock->semaphore);
-	lock->holder = t;
 
-	 // MLFQ 모드가 아닐 때만 wait_on_lock 초기화
-	 // MLFQ 는 우선순위 기부가 일어나지 않는다.
-	 if (!thread_mlfqs) {
-        t->wait_on_lock = NULL;
-    }
+	if (lock->stat != NULL && contended) {
+		uint64_t wait = rdtsc () - start;
+		lock->stat->contended++;
+		lock->stat->wait_total += wait;
+		if (wait > lock->stat->wait_max)
+			lock->stat->wait_max = wait;
+	}
+
+	if (t->wait_on_lock != NULL) {
+		heap_remove (&lock->waiters, &t->lock_elem);
+		t->wait_on_lock = NULL;
+	}
+	lock_set_holder (lock);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -225,14 +398,17 @@ lock_acquire (struct lock *lock) {
    interrupt handler. */
 bool
 lock_try_acquire (struct lock *lock) {
+	enum intr_level old_level;
 	bool success;
 
 	ASSERT (lock != NULL);
 	ASSERT (!lock_held_by_current_thread (lock));
 
+	old_level = intr_disable ();
 	success = sema_try_down (&lock->semaphore);
 	if (success)
-		lock->holder = thread_current ();
+		lock_set_holder (lock);
+	intr_set_level (old_level);
 	return success;
 }
 
@@ -247,16 +423,25 @@ lock_release (struct lock *lock) {
 	ASSERT (lock != NULL);
 	ASSERT (lock_held_by_current_thread (lock));
 
+	enum intr_level old_level = intr_disable ();
+
+	if (lock->stat != NULL) {
+		uint64_t hold = rdtsc () - lock->acquired_tsc;
+		lock->stat->hold_total += hold;
+		if (hold > lock->stat->hold_max)
+			lock->stat->hold_max = hold;
+	}
 	lock->holder = NULL;
 
 	// MLFQ 모드가 아닐 때만 우선순위 기부 반환 로직 실행
-	// MLFQ는 우선순위 기부가 일어나지 않는다.
-	if (!thread_mlfqs) {
-		remove_with_lock(lock);
-		refresh_priority();
+	// 남은 대기자들은 이 락을 다음에 얻는 스레드에게 기부한다.
+	if (sched_class->donation) {
+		heap_remove (&thread_current ()->held_locks, &lock->elem);
+		refresh_priority ();
 	}
-	
+
 	sema_up (&lock->semaphore);
+	intr_set_level (old_level);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -269,12 +454,167 @@ lock_held_by_current_thread (const struct lock *lock) {
 	return lock->holder == thread_current ();
 }
 
-/* One semaphore in a list. */
-struct semaphore_elem {
-	struct list_elem elem;              /* List element. */
-	struct semaphore semaphore;         /* This semaphore. */
+/* Initializes RW as an unlocked reader-writer lock.  NAME is
+   given to its internal lock, as for lock_init_named(). */
+void
+rwlock_init_named (struct rwlock *rw, const char *name) {
+	ASSERT (rw != NULL);
+
+	lock_init_named (&rw->lock, name);
+	rw->readers = 0;
+	list_init (&rw->reader_list);
+	rw->writer_waiting = false;
+	sema_init (&rw->drained, 0);
+}
+
+/* Returns the current thread's rw_reads[] slot for RW, or a free
+   slot if RW is null. */
+static struct rw_read *
+rw_read_slot (struct rwlock *rw) {
+	struct thread *t = thread_current ();
+	int i;
+
+	for (i = 0; i < RW_READ_MAX; i++)
+		if (t->rw_reads[i].rw == rw)
+			return &t->rw_reads[i];
+	return NULL;
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or
+   waits for it.  A thread must not acquire the same RW for
+   reading twice, since a writer may arrive in between, and may
+   hold at most RW_READ_MAX rwlocks for reading at once. */
+void
+rwlock_acquire_read (struct rwlock *rw) {
+	enum intr_level old_level;
+	struct rw_read *r;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (rw_read_slot (rw) == NULL);
+
+	r = rw_read_slot (NULL);
+	ASSERT (r != NULL);
+
+	lock_acquire (&rw->lock);
+	old_level = intr_disable ();
+	rw->readers++;
+	r->rw = rw;
+	r->thread = thread_current ();
+	list_push_back (&rw->reader_list, &r->elem);
+	intr_set_level (old_level);
+	lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for reading.  The
+   last reader out wakes a writer waiting to get in.  A thread
+   that no longer reads anything gives back any priority that
+   waiting writers donated to it. */
+void
+rwlock_release_read (struct rwlock *rw) {
+	enum intr_level old_level;
+	struct rw_read *r;
+	int i;
+
+	ASSERT (rw != NULL);
+
+	r = rw_read_slot (rw);
+	ASSERT (r != NULL);
+
+	old_level = intr_disable ();
+	ASSERT (rw->readers > 0);
+	list_remove (&r->elem);
+	r->rw = NULL;
+	if (--rw->readers == 0 && rw->writer_waiting) {
+		rw->writer_waiting = false;
+		sema_up (&rw->drained);
+	}
+
+	for (i = 0; i < RW_READ_MAX; i++)
+		if (thread_current ()->rw_reads[i].rw != NULL)
+			break;
+	if (i == RW_READ_MAX) {
+		/* 기부를 거두고 나면 방금 깨운 쓰기 대기자가 더 높을 수 있다. */
+		thread_rw_restore ();
+		cmp_nowNfirst ();
+	}
+	intr_set_level (old_level);
+}
+
+/* Acquires RW for writing.  Once the writer holds the internal
+   lock no new reader can enter, so it only has to wait for the
+   current readers to drain.  Meanwhile it donates its priority
+   to them, so that a low-priority reader cannot keep it out. */
+void
+rwlock_acquire_write (struct rwlock *rw) {
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+
+	lock_acquire (&rw->lock);
+	old_level = intr_disable ();
+	while (rw->readers > 0) {
+		if (sched_class->donation) {
+			struct list_elem *e;
+
+			for (e = list_begin (&rw->reader_list); e != list_end (&rw->reader_list);
+					e = list_next (e))
+				thread_rw_donate (list_entry (e, struct rw_read, elem)->thread,
+						thread_get_priority ());
+		}
+		rw->writer_waiting = true;
+		sema_down (&rw->drained);
+	}
+	intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread holds for writing. */
+void
+rwlock_release_write (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+	ASSERT (rwlock_held_for_write (rw));
+
+	lock_release (&rw->lock);
+}
+
+/* Returns true if the current thread holds RW for writing. */
+bool
+rwlock_held_for_write (const struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	return lock_held_by_current_thread (&rw->lock) && rw->readers == 0;
+}
+
+/* State of a condition waiter. */
+enum cond_state {
+	COND_WAITING,               /* Not signaled yet. */
+	COND_SIGNALED,              /* Signaled; must acquire the lock itself. */
+	COND_MORPHED                /* Moved onto the lock's wait queue. */
+};
+
+/* One thread in a condition's wait heap. */
+struct cond_waiter {
+	struct heap_elem elem;              /* Heap element. */
+	struct thread *thread;              /* Waiting thread. */
+	uint64_t seq;                       /* Arrival order. */
+	enum cond_state state;              /* Set by cond_signal(). */
+	uint64_t morph_tsc;                 /* TSC when morphed, if profiling. */
 };
 
+/* Orders condition waiters by their thread's priority, then by
+   arrival. */
+static bool
+cond_waiter_less (const struct heap_elem *a_, const struct heap_elem *b_,
+                  void *aux UNUSED) {
+	const struct cond_waiter *a = heap_entry (a_, struct cond_waiter, elem);
+	const struct cond_waiter *b = heap_entry (b_, struct cond_waiter, elem);
+
+	if (a->thread->priority != b->thread->priority)
+		return a->thread->priority < b->thread->priority;
+	return a->seq > b->seq;
+}
+
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -282,7 +622,7 @@ void
 cond_init (struct condition *cond) {
 	ASSERT (cond != NULL);
 
-	list_init (&cond->waiters);
+	heap_init (&cond->waiters, cond_waiter_less, NULL);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -301,25 +641,75 @@ cond_init (struct condition *cond) {
    condition variables.  That is, there is a one-to-many mapping
    from locks to condition variables.
 
+   A signaled waiter is usually not woken by the signal itself:
+   cond_signal() moves it onto LOCK's wait queue ("wait
+   morphing"), and it runs only once the signaling thread releases
+   LOCK to it.  A broadcast therefore wakes one waiter per
+   release instead of a herd that immediately blocks on LOCK
+   again.
+
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
    we need to sleep. */
 void
 cond_wait (struct condition *cond, struct lock *lock) {
-	struct semaphore_elem waiter;
+	struct cond_waiter waiter;
+	struct thread *t = thread_current ();
+	enum intr_level old_level;
 
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
 
-	sema_init (&waiter.semaphore, 0);
-	//list_push_back (&cond->waiters, &waiter.elem);
-	list_insert_ordered(&cond->waiters, &waiter.elem, cmp_sem_priority, NULL);
+	waiter.thread = t;
+	waiter.state = COND_WAITING;
+
+	old_level = intr_disable ();
+	waiter.seq = wait_seq++;
+	t->cond_heap = &cond->waiters;
+	t->cond_elem = &waiter.elem;
+	heap_insert (&cond->waiters, &waiter.elem);
+
+	/* lock_release() may yield to a waiter it wakes, and we may be
+	   signaled before we get back here; only block if we were not. */
 	lock_release (lock);
-	sema_down (&waiter.semaphore);
-	lock_acquire (lock);
+	if (waiter.state == COND_WAITING)
+		thread_block ();
+
+	if (waiter.state == COND_MORPHED)
+		lock_wait (lock, true, waiter.morph_tsc);
+	else
+		lock_acquire (lock);
+	intr_set_level (old_level);
+}
+
+/* Moves WAITER, which is blocked in cond_wait(), from its
+   condition onto LOCK's wait queue, as if it had called
+   lock_acquire() while the current thread holds LOCK.  Its
+   priority is donated to the current thread like any other lock
+   waiter's.  Interrupts must be off. */
+static void
+cond_morph (struct cond_waiter *waiter, struct lock *lock) {
+	struct thread *t = waiter->thread;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (t->status == THREAD_BLOCKED);
+
+	waiter->state = COND_MORPHED;
+	waiter->morph_tsc = lock->stat != NULL ? rdtsc () : 0;
+
+	t->wait_seq = wait_seq++;
+	t->wait_heap = &lock->semaphore.waiters;
+	heap_insert (&lock->semaphore.waiters, &t->wait_elem);
+
+	if (sched_class->donation) {
+		t->wait_on_lock = lock;
+		heap_insert (&lock->waiters, &t->lock_elem);
+		heap_update (&thread_current ()->held_locks, &lock->elem);
+		refresh_priority ();
+	}
 }
 
 /* If any threads are waiting on COND (protected by LOCK), then
@@ -330,21 +720,35 @@ cond_wait (struct condition *cond, struct lock *lock) {
    make sense to try to signal a condition variable within an
    interrupt handler. */
 void
-cond_signal (struct condition *cond, struct lock *lock UNUSED) {
+cond_signal (struct condition *cond, struct lock *lock) {
+	enum intr_level old_level;
+
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
 
-	if (!list_empty (&cond->waiters))
-		/* 세마포어의 watier list내에 스레드들의 우선순위에 따라 정렬한다. */	
-	   list_sort(&cond->waiters, cmp_sem_priority, NULL);
-		sema_up (&list_entry (list_pop_front (&cond->waiters),
-					struct semaphore_elem, elem)->semaphore);
+	old_level = intr_disable ();
+	if (!heap_empty (&cond->waiters)) {
+		struct cond_waiter *waiter = heap_entry (heap_pop (&cond->waiters),
+		                                         struct cond_waiter, elem);
+		waiter->thread->cond_heap = NULL;
+
+		/* A waiter that has not reached thread_block() yet is
+		   still runnable; it will see the new state and take the
+		   lock the ordinary way. */
+		if (waiter->thread->status == THREAD_BLOCKED)
+			cond_morph (waiter, lock);
+		else
+			waiter->state = COND_SIGNALED;
+	}
+	intr_set_level (old_level);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
-   LOCK).  LOCK must be held before calling this function.
+   LOCK).  LOCK must be held before calling this function.  All of
+   them move to LOCK's wait queue and run one at a time as LOCK is
+   passed along.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to signal a condition variable within an
@@ -354,31 +758,6 @@ cond_broadcast (struct condition *cond, struct lock *lock) {
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 
-	while (!list_empty (&cond->waiters))
+	while (!heap_empty (&cond->waiters))
 		cond_signal (cond, lock);
 }
-
-
-
-
-bool cmp_sem_priority(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED) {
-    struct semaphore_elem *sema_a = list_entry(a, struct semaphore_elem, elem);
-    struct semaphore_elem *sema_b = list_entry(b, struct semaphore_elem, elem);
- 
-    if (sema_a == NULL || sema_b == NULL)
-        return false;
- 
-    struct list *list_a = &(sema_a->semaphore.waiters);
-    struct list *list_b = &(sema_b->semaphore.waiters);
- 
-    if (list_a == NULL || list_b == NULL)
-        return false;
- 
-    struct thread *thread_a = list_entry(list_begin(list_a), struct thread, elem);
-    struct thread *thread_b = list_entry(list_begin(list_b), struct thread, elem);
- 
-    if (thread_a == NULL || thread_b == NULL)
-        return false;
- 
-    return thread_a->priority > thread_b->priority;
-}
\ No newline at end of file
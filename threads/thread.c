@@ -8,10 +8,12 @@
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 #include "intrinsic.h"
 #include "threads/fixed_point.h" // MLFQ 부동소수점 계산을 위한 헤더
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "filesys/file.h" 
@@ -26,9 +28,24 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Run queue of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+   우선순위 단계마다 FIFO 큐를 하나씩 두고, mask의 i번째 비트로
+   queue[i]가 비어 있지 않음을 표시한다.  가장 높은 우선순위 큐는
+   비트 스캔 한 번으로 찾는다.  인터럽트를 끈 채로만 건드린다. */
+struct runqueue {
+	struct list queue[PRI_MAX + 1];
+	uint64_t mask;
+	size_t cnt;                     /* 큐에 있는 전체 스레드 수 */
+
+	/* stride 클래스용: pass가 가장 작은 스레드가 top인 힙과, 마지막으로
+	   꺼낸 스레드의 pass.  오래 잠들었던 스레드는 floor까지 끌어올려
+	   밀린 몫을 한꺼번에 쓰지 못하게 한다. */
+	struct heap stride_heap;
+	int64_t pass_floor;
+};
+
+static struct runqueue ready_rq;
 
 /* Idle thread. */
 static struct thread *idle_thread;
@@ -36,6 +53,10 @@ static struct thread *idle_thread;
 /* MLFQ에서 모든 스레드를 추적하며 주기적 재계산을 하기 위한 리스트다. */
 static struct list all_list;
 
+/* 마지막 우선순위 재계산 이후 recent_cpu가 바뀐 스레드 목록.
+   4틱마다의 우선순위 갱신은 이 목록에 있는 스레드만 다시 계산한다. */
+static struct list mlfqs_dirty_list;
+
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
@@ -45,8 +66,22 @@ static struct lock tid_lock;
 /* Thread destruction requests */
 static struct list destruction_req;
 
-/* sleep queue */
-static struct list sleep_list;
+/* 죽은 스레드의 페이지를 palloc에 돌려주지 않고 모아 두었다가
+   thread_create()가 다시 쓴다.  init_thread()가 struct thread 부분만
+   0으로 채우므로 페이지 전체를 지울 필요가 없고, fork/exit가 잦을 때
+   palloc 비트맵 검색도 피할 수 있다.  THREAD_CACHE_MAX개를 넘는
+   페이지만 palloc으로 돌아간다.  캐시는 인터럽트를 끈 채로만 건드린다. */
+#define THREAD_CACHE_MAX 32
+static struct thread *thread_cache[THREAD_CACHE_MAX];
+static size_t thread_cache_cnt;
+static long long thread_pages_reused;     /* 캐시에서 꺼낸 페이지 수 */
+static long long thread_pages_allocated;  /* palloc에서 새로 받은 페이지 수 */
+
+/* sleep queue.  weakeup_tick을 키로 하는 intrusive pairing heap이다.
+   삽입은 O(1), 가장 빨리 깨어날 스레드를 꺼내는 것은 amortized
+   O(log n)이므로 타이머 인터럽트가 잠든 스레드 수에 비례해 길어지지
+   않는다.  노드는 struct thread의 sleep_child/sleep_sibling을 쓴다. */
+static struct thread *sleep_heap;
 static int64_t next_tick_to_awake;
 
 #define MAX_DONATION_DEPTH 8
@@ -65,6 +100,83 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. */
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, use the stride (proportional-share) scheduler.
+   Controlled by kernel command-line option "-stride". */
+bool thread_stride;
+
+/* 두 스케줄링 클래스.  둘 다 우선순위 단계별 run queue를 쓰고,
+   우선순위를 누가 정하는지(사용자와 기부, 또는 recent_cpu와 nice)만
+   다르다. */
+static void prio_init_thread (struct thread *, int priority);
+static void prio_exit_thread (struct thread *);
+static void prio_set_priority (struct thread *, int priority);
+static void mlfqs_init_thread (struct thread *, int priority);
+static void mlfqs_exit_thread (struct thread *);
+static void mlfqs_set_priority (struct thread *, int priority);
+static void rq_insert (struct runqueue *, struct thread *);
+static void rq_delete (struct runqueue *, struct thread *);
+static struct thread *rq_pick (struct runqueue *);
+static void prio_tick (struct thread *);
+static void mlfqs_tick (struct thread *);
+static bool prio_yield_check (struct runqueue *, struct thread *);
+static void stride_init_thread (struct thread *, int priority);
+static void stride_set_priority (struct thread *, int priority);
+static void stride_enqueue (struct runqueue *, struct thread *);
+static void stride_dequeue (struct runqueue *, struct thread *);
+static struct thread *stride_pick (struct runqueue *);
+static void stride_tick (struct thread *);
+static bool stride_yield_check (struct runqueue *, struct thread *);
+static bool stride_less (const struct heap_elem *, const struct heap_elem *,
+		void *aux);
+
+static const struct sched_class sched_priority = {
+	.name = "priority",
+	.donation = true,
+	.periodic = false,
+	.init_thread = prio_init_thread,
+	.exit_thread = prio_exit_thread,
+	.set_priority = prio_set_priority,
+	.enqueue = rq_insert,
+	.dequeue = rq_delete,
+	.pick_next = rq_pick,
+	.tick = prio_tick,
+	.yield_check = prio_yield_check,
+};
+
+static const struct sched_class sched_mlfqs = {
+	.name = "mlfqs",
+	.donation = false,
+	.periodic = true,
+	.init_thread = mlfqs_init_thread,
+	.exit_thread = mlfqs_exit_thread,
+	.set_priority = mlfqs_set_priority,
+	.enqueue = rq_insert,
+	.dequeue = rq_delete,
+	.pick_next = rq_pick,
+	.tick = mlfqs_tick,
+	.yield_check = prio_yield_check,
+};
+
+/* Stride 클래스: 스레드는 tickets에 비례해 CPU를 나눠 가진다.
+   기부는 하지 않는다.  굶는 스레드가 없으므로 우선순위 역전이
+   무한정 이어지지 않는다. */
+static const struct sched_class sched_stride = {
+	.name = "stride",
+	.donation = false,
+	.periodic = false,
+	.init_thread = stride_init_thread,
+	.exit_thread = mlfqs_exit_thread,     /* all_list에서 뺀다. */
+	.set_priority = stride_set_priority,
+	.enqueue = stride_enqueue,
+	.dequeue = stride_dequeue,
+	.pick_next = stride_pick,
+	.tick = stride_tick,
+	.yield_check = stride_yield_check,
+};
+
+/* 부팅 때 thread_init()이 고른 스케줄링 클래스. */
+const struct sched_class *sched_class = &sched_priority;
+
 /* 시스템 부하 상태를 나타내는 지표 */
 int load_avg;
 
@@ -72,10 +184,18 @@ static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
 static struct thread *next_thread_to_run (void);
+static void runqueue_init (struct runqueue *);
+static struct thread *thread_page_get (void);
+static void thread_page_reclaim (void);
+static int rq_max_priority (struct runqueue *);
+static struct thread *rq_pop (struct runqueue *);
+static void ready_push (struct thread *);
 static void init_thread (struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule (void);
 static tid_t allocate_tid (void);
+static struct thread *sleep_heap_meld (struct thread *, struct thread *);
+static struct thread *sleep_heap_pop (void);
 
 /* Returns true if T appears to point to a valid thread. */
 #define is_thread(t) ((t) != NULL && (t)->magic == THREAD_MAGIC)
@@ -119,22 +239,28 @@ thread_init (void) {
 	};
 	lgdt (&gdt_ds);
 
+	/* 스케줄링 클래스는 여기서 한 번만 고른다. */
+	if (thread_mlfqs)
+		sched_class = &sched_mlfqs;
+	else if (thread_stride)
+		sched_class = &sched_stride;
+	else
+		sched_class = &sched_priority;
+
 	/* Init the globla thread context */
 	lock_init (&tid_lock);
-	list_init (&ready_list);
+	runqueue_init (&ready_rq);
 	list_init (&destruction_req);
-	list_init (&sleep_list);
-	list_init (&all_list); /* MLFQ all_list 초기화 */
+	sleep_heap = NULL;
+	next_tick_to_awake = INT64_MAX;
+	list_init (&all_list); /* MLFQ, stride all_list 초기화 */
+	list_init (&mlfqs_dirty_list);
 	
 
 	/* Set up a thread structure for the running thread. */
 	initial_thread = running_thread ();
 	init_thread (initial_thread, "main", PRI_DEFAULT);
 
-	/* 메인 스레드를 all_list에 포함시킨다. */
-	if (thread_mlfqs)
-	list_push_back(&all_list, &(initial_thread->all_elem));
-
 	initial_thread->status = THREAD_RUNNING;
 	initial_thread->tid = allocate_tid ();
 }
@@ -177,6 +303,8 @@ thread_tick (void) {
 #endif
 	else
 		kernel_ticks++;
+	if (t != idle_thread)
+		t->run_ticks++;
 
 	/* Enforce preemption. */
 	/* 
@@ -186,6 +314,16 @@ thread_tick (void) {
 	*/
 	if (++thread_ticks >= TIME_SLICE)
 		intr_yield_on_return (); // 타이머 인터럽트가 끝나는 시점에 thread_yield() 실행
+
+	/* 클래스별 tick 처리 (MLFQS의 recent_cpu, load_avg 갱신 등). */
+	sched_class->tick (t);
+}
+
+/* Accounts TICKS timer ticks that went by without a timer
+   interrupt while the idle thread was halted in tickless mode. */
+void
+thread_account_idle (int64_t ticks) {
+	idle_ticks += ticks;
 }
 
 /* Prints thread statistics. */
@@ -193,6 +331,44 @@ void
 thread_print_stats (void) {
 	printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
 			idle_ticks, kernel_ticks, user_ticks);
+	printf ("Thread pages: %lld reused, %lld allocated\n",
+			thread_pages_reused, thread_pages_allocated);
+
+	/* stride 스케줄러에서는 살아 있는 스레드마다 tickets로 정해진 몫과
+	   실제로 받은 CPU 몫을 나란히 보여 준다.  idle 스레드는 tick을
+	   idle_ticks로 따로 세므로 빼고, actual은 idle이 아닌 tick 대비
+	   백분율이다.  share는 막혀 있는 스레드까지 포함한 살아 있는
+	   스레드 전체의 tickets 대비 백분율이므로, 모두가 계속 실행 가능할
+	   때에만 actual과 맞아야 한다. */
+	if (sched_class == &sched_stride) {
+		enum intr_level old_level = intr_disable ();
+		long long busy = kernel_ticks + user_ticks;
+		long long total_tickets = 0;
+		struct list_elem *e;
+
+		for (e = list_begin (&all_list); e != list_end (&all_list); e = list_next (e)) {
+			struct thread *t = list_entry (e, struct thread, all_elem);
+
+			if (t != idle_thread)
+				total_tickets += t->tickets;
+		}
+
+		printf ("Stride: %lld tickets in live threads\n", total_tickets);
+		printf ("%5s %-16s %7s %10s %7s %7s\n",
+				"tid", "name", "tickets", "ticks", "share", "actual");
+		for (e = list_begin (&all_list); e != list_end (&all_list); e = list_next (e)) {
+			struct thread *t = list_entry (e, struct thread, all_elem);
+
+			if (t == idle_thread)
+				continue;
+			printf ("%5d %-16s %7d %10llu %6lld%% %6lld%%\n",
+					t->tid, t->name, t->tickets,
+					(unsigned long long) t->run_ticks,
+					total_tickets > 0 ? t->tickets * 100 / total_tickets : 0,
+					busy > 0 ? (long long) t->run_ticks * 100 / busy : 0);
+		}
+		intr_set_level (old_level);
+	}
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -214,12 +390,13 @@ tid_t
 thread_create (const char *name, int priority,
 		thread_func *function, void *aux) {
 	struct thread *t;
+	struct switch_frame *sf;
 	tid_t tid;
 
 	ASSERT (function != NULL);
 
 	/* Allocate thread. */
-	t = palloc_get_page (PAL_ZERO);
+	t = thread_page_get ();
 	if (t == NULL)
 		return TID_ERROR;
 
@@ -228,35 +405,26 @@ thread_create (const char *name, int priority,
 	tid = t->tid = allocate_tid ();
 
 #ifdef USERPROG
-    t->fd_table = palloc_get_multiple(PAL_ZERO, FDT_PAGES);
-    if (t->fd_table == NULL)
-        return TID_ERROR;
+    /* FDT는 struct thread 안의 작은 배열로 시작한다. 따로 할당하지 않는다. */
+    process_init_fdt(t);
 
     t->exit_status = 0;  // exit_status 초기화
-
-    t->fd_idx = 3;
-    t->fd_table[0] = 0;  // stdin 예약된 자리 (dummy)
-    t->fd_table[1] = 1;  // stdout 예약된 자리 (dummy)
-    t->fd_table[2] = 2;  // stderr 예약된 자리 (dummy)
-
-    list_push_back(&thread_current()->child_list, &t->child_elem);
 #endif	
 
 	/* Call the kernel_thread if it scheduled.
-	 * Note) rdi is 1st argument, and rsi is 2nd argument. */
-	t->tf.rip = (uintptr_t) kernel_thread;
-	t->tf.R.rdi = (uint64_t) function;
-	t->tf.R.rsi = (uint64_t) aux;
-	t->tf.ds = SEL_KDSEG;
-	t->tf.es = SEL_KDSEG;
-	t->tf.ss = SEL_KDSEG;
-	t->tf.cs = SEL_KCSEG;
-	t->tf.eflags = FLAG_IF;
+	 * 처음 스케줄되면 switch_threads()가 이 프레임을 꺼내 switch_entry로
+	 * 돌아가고, switch_entry는 kernel_thread (FUNCTION, AUX)를 호출한다.
+	 * 프레임은 ret 이후 rsp가 16바이트 정렬되도록 놓는다. */
+	sf = (struct switch_frame *) ((uint8_t *) t + PGSIZE - 16) - 1;
+	sf->rbx = (uint64_t) kernel_thread;
+	sf->r12 = (uint64_t) function;
+	sf->r13 = (uint64_t) aux;
+	sf->rip = switch_entry;
+	t->switch_rsp = (uint64_t) sf;
 	/* Add to run queue. */
 	thread_unblock (t);
-	/* 현재와 가장 높은 우선순위 비교후 현재보다 우선순위가 높다면 양보 */
-	if(t->priority > thread_current()->priority)
-	thread_yield();
+	/* 새 스레드가 현재 스레드를 선점해야 하면 양보 */
+	cmp_nowNfirst ();
 
 	return tid;
 }
@@ -291,8 +459,8 @@ thread_unblock (struct thread *t) {
 
 	old_level = intr_disable ();
 	ASSERT (t->status == THREAD_BLOCKED);
-	//FIFO-> priority로 변경
-	list_insert_ordered (&ready_list, &t->elem, cmp_priority, NULL);
+	/* 우선순위 단계별 큐의 뒤에 넣는다. 같은 단계 안에서는 FIFO. */
+	ready_push (t);
 	t->status = THREAD_READY;
 	intr_set_level (old_level);
 }
@@ -336,12 +504,10 @@ thread_exit (void) {
 #ifdef USERPROG
 	process_exit ();
 #endif
-	/* 스레드가 종료될 때 all_list에서 현재 스레드 요소 제거 */
-	if (thread_mlfqs)
-	list_remove(&thread_current()->all_elem);
 	/* Just set our status to dying and schedule another process.
 	We will be destroyed during the call to schedule_tail(). */
 	intr_disable ();
+	sched_class->exit_thread (curr);
 	// sema_down(&curr->free_sema);
 	do_schedule (THREAD_DYING);
 	NOT_REACHED ();
@@ -359,7 +525,7 @@ thread_yield (void) {
 
     old_level = intr_disable ();
     if (curr != idle_thread)
-        list_insert_ordered (&ready_list, &curr->elem, cmp_priority, NULL);
+        ready_push (curr);
     do_schedule (THREAD_READY);
     intr_set_level (old_level);
 }
@@ -368,17 +534,8 @@ thread_yield (void) {
 /* Sets the current thread's priority to NEW_PRIORITY. */
 // 우선 순위 변경 -> 우선순위에 따라 선점 
 void thread_set_priority (int new_priority) {
+	sched_class->set_priority (thread_current (), new_priority);
 
-	/* MLFQ를 사용할 때는 우선순위를 임의로 변경하지 않는다. */
-	if (thread_mlfqs)
-        return;
-
-	/* 현재 스레드의 원래 우선순위를 설정한다. */
-	thread_current()->init_priority = new_priority;
- 
-	/* 우선순위를 재 계산한다.  */
-	refresh_priority();
- 
 	/* 우선순위에 따른 스케줄링 진행 */
 	cmp_nowNfirst();
 }
@@ -407,6 +564,30 @@ thread_set_nice (int nice UNUSED) {
 
 }
 
+/* Sets the current thread's stride tickets to TICKETS, clamped to
+   TICKETS_MIN..TICKETS_MAX.  Only the stride scheduler uses them. */
+void
+thread_set_tickets (int tickets) {
+	struct thread *t = thread_current ();
+	enum intr_level old_level;
+
+	if (tickets < TICKETS_MIN)
+		tickets = TICKETS_MIN;
+	if (tickets > TICKETS_MAX)
+		tickets = TICKETS_MAX;
+
+	old_level = intr_disable ();
+	t->tickets = tickets;
+	t->stride = STRIDE_ONE / tickets;
+	intr_set_level (old_level);
+}
+
+/* Returns the current thread's stride tickets. */
+int
+thread_get_tickets (void) {
+	return thread_current ()->tickets;
+}
+
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) {
@@ -467,6 +648,9 @@ idle (void *idle_started_ UNUSED) {
 		intr_disable ();
 		thread_block ();
 
+		/* tickless 모드면 다음에 깨어날 시각까지 주기 tick을 멈춘다. */
+		timer_idle_enter ();
+
 		/* Re-enable interrupts and wait for the next one.
 
 		   The `sti' instruction disables interrupts until the
@@ -508,30 +692,35 @@ init_thread (struct thread *t, const char *name, int priority) {
 
     t->status = THREAD_BLOCKED;
     strlcpy (t->name, name, sizeof t->name);
-    t->tf.rsp = (uint64_t) t + PGSIZE - sizeof (void *);
 
-    /* MLFQ 사용 여부에 따라 우선순위 초기화 */
-    if (thread_mlfqs) {
-        mlfqs_priority(t);
-        list_push_back(&all_list, &t->all_elem);
-    } else {
-        t->priority = priority;
-    }
+    /* 우선순위 초기화는 스케줄링 클래스가 한다. */
+    sched_class->init_thread (t, priority);
 
 #ifdef USERPROG
 	t->exit_status = 0;
 	t->running = NULL;
 
 	sema_init(&t->wait_sema, 0);
-	sema_init(&t->fork_sema, 0);
 	sema_init(&t->exit_sema, 0);
 
-	/* 프로세스 관계 초기화 */
+	/* 프로세스 관계 초기화.  child_info는 process_spawn()이 채운다. */
 	list_init(&t->child_list);
+	t->child_info = NULL;
+
+	/* 유저 스레드를 만들기 전까지는 스스로가 프로세스의 leader이다. */
+	t->leader = t;
+	list_init(&t->uthread_list);
+	t->exiting = false;
+	lock_init(&t->fd_lock);
 #endif
     /* 우선순위 기부용 필드 초기화 */
     t->wait_on_lock = NULL;
-    list_init(&t->donations);
+    heap_init(&t->held_locks, cmp_lock_priority, NULL);
+    for (int i = 0; i < RW_READ_MAX; i++)
+        t->rw_reads[i].rw = NULL;
+    t->rw_donated = -1;
+    t->wait_heap = NULL;
+    t->cond_heap = NULL;
 
     /* 스택 오버플로우 검출용 매직 넘버 설정 */
     t->magic = THREAD_MAGIC;
@@ -549,10 +738,251 @@ init_thread (struct thread *t, const char *name, int priority) {
    idle_thread. */
 static struct thread *
 next_thread_to_run (void) {
-	if (list_empty (&ready_list))
-		return idle_thread;
-	else
-		return list_entry (list_pop_front (&ready_list), struct thread, elem);
+	struct thread *t = rq_pop (&ready_rq);
+
+	return t != NULL ? t : idle_thread;
+}
+
+/* 우선순위 클래스: 우선순위는 사용자가 정하고 락이 기부한다. */
+static void
+prio_init_thread (struct thread *t, int priority) {
+	t->priority = priority;
+}
+
+static void
+prio_exit_thread (struct thread *t UNUSED) {
+}
+
+static void
+prio_set_priority (struct thread *t, int priority) {
+	ASSERT (t == thread_current ());
+
+	/* 현재 스레드의 원래 우선순위를 설정하고 기부를 반영해 다시 계산한다. */
+	t->init_priority = priority;
+	refresh_priority ();
+}
+
+static void
+prio_tick (struct thread *t UNUSED) {
+}
+
+/* RQ에 T보다 우선순위가 높은 스레드가 있으면 T를 선점해야 한다. */
+static bool
+prio_yield_check (struct runqueue *rq, struct thread *t) {
+	return rq_max_priority (rq) > t->priority;
+}
+
+/* MLFQS 클래스: 우선순위는 recent_cpu와 nice로 계산하며 사용자가
+   바꿀 수 없다.  모든 스레드를 all_list로 추적한다. */
+static void
+mlfqs_init_thread (struct thread *t, int priority UNUSED) {
+	mlfqs_priority (t);
+	list_push_back (&all_list, &t->all_elem);
+}
+
+/* 스레드가 종료될 때 all_list와 재계산 대기 목록에서 뺀다. */
+static void
+mlfqs_exit_thread (struct thread *t) {
+	list_remove (&t->all_elem);
+	if (t->mlfqs_dirty)
+		list_remove (&t->dirty_elem);
+}
+
+static void
+mlfqs_set_priority (struct thread *t UNUSED, int priority UNUSED) {
+}
+
+/* 매 tick recent_cpu를 올리고, 1초마다 load_avg와 모든 스레드의
+   recent_cpu를, 4틱마다 recent_cpu가 바뀐 스레드의 우선순위를
+   다시 계산한다. */
+static void
+mlfqs_tick (struct thread *t UNUSED) {
+	int64_t ticks = timer_ticks ();
+
+	mlfqs_increment ();
+	if (ticks % TIMER_FREQ == 0) {
+		mlfqs_load_avg ();
+		mlfqs_recalc_recent_cpu ();
+	}
+	if (ticks % 4 == 0)
+		mlfqs_recalc_priority ();
+}
+
+/* Stride 클래스.  매 tick 실행 중인 스레드의 pass를 stride만큼
+   올리고, 항상 pass가 가장 작은 스레드를 고른다.  stride는 tickets에
+   반비례하므로 tickets가 두 배인 스레드는 CPU를 두 배 받는다.
+   우선순위 API는 tickets로 옮겨 priority + 1장을 준다. */
+static void
+stride_init_thread (struct thread *t, int priority) {
+	t->priority = priority;
+	t->tickets = priority + 1;
+	t->stride = STRIDE_ONE / t->tickets;
+	t->pass = 0;
+	list_push_back (&all_list, &t->all_elem);
+}
+
+static void
+stride_set_priority (struct thread *t, int priority) {
+	t->init_priority = priority;
+	t->priority = priority;
+	thread_set_tickets (priority + 1);
+}
+
+/* T를 RQ의 pass 힙에 넣는다.  pass가 floor보다 뒤처졌으면 floor로
+   끌어올린다. */
+static void
+stride_enqueue (struct runqueue *rq, struct thread *t) {
+	if (t->pass < rq->pass_floor)
+		t->pass = rq->pass_floor;
+	heap_insert (&rq->stride_heap, &t->stride_elem);
+}
+
+static void
+stride_dequeue (struct runqueue *rq, struct thread *t) {
+	heap_remove (&rq->stride_heap, &t->stride_elem);
+}
+
+static struct thread *
+stride_pick (struct runqueue *rq) {
+	struct thread *t;
+
+	if (heap_empty (&rq->stride_heap))
+		return NULL;
+	t = heap_entry (heap_pop (&rq->stride_heap), struct thread, stride_elem);
+	if (t->pass > rq->pass_floor)
+		rq->pass_floor = t->pass;
+	return t;
+}
+
+static void
+stride_tick (struct thread *t) {
+	if (t != idle_thread)
+		t->pass += t->stride;
+}
+
+/* RQ에 T보다 pass가 작은 스레드가 있으면 T를 선점해야 한다. */
+static bool
+stride_yield_check (struct runqueue *rq, struct thread *t) {
+	struct thread *top;
+
+	if (heap_empty (&rq->stride_heap))
+		return false;
+	top = heap_entry (heap_top (&rq->stride_heap), struct thread, stride_elem);
+	return top->pass < t->pass;
+}
+
+/* pass가 작을수록 크다고 보아 힙의 top에 오게 한다.  같으면 tid가
+   작은 쪽이 먼저다. */
+static bool
+stride_less (const struct heap_elem *a_, const struct heap_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = heap_entry (a_, struct thread, stride_elem);
+	const struct thread *b = heap_entry (b_, struct thread, stride_elem);
+
+	if (a->pass != b->pass)
+		return a->pass > b->pass;
+	return a->tid > b->tid;
+}
+
+static void
+runqueue_init (struct runqueue *rq) {
+	for (int i = PRI_MIN; i <= PRI_MAX; i++)
+		list_init (&rq->queue[i]);
+	rq->mask = 0;
+	rq->cnt = 0;
+	heap_init (&rq->stride_heap, stride_less, NULL);
+	rq->pass_floor = 0;
+}
+
+/* T를 자신의 우선순위 큐 맨 뒤에 넣고 occupancy 비트를 켠다. */
+static void
+rq_insert (struct runqueue *rq, struct thread *t) {
+	ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+	list_push_back (&rq->queue[t->priority], &t->elem);
+	rq->mask |= 1ULL << t->priority;
+}
+
+/* RQ에 있는 T를 빼고, 큐가 비면 해당 비트를 끈다.
+   T->priority는 T가 들어간 큐의 번호와 같아야 한다. */
+static void
+rq_delete (struct runqueue *rq, struct thread *t) {
+	list_remove (&t->elem);
+	if (list_empty (&rq->queue[t->priority]))
+		rq->mask &= ~(1ULL << t->priority);
+}
+
+/* RQ에서 가장 높은 우선순위 큐의 맨 앞 스레드를 꺼낸다.
+   RQ가 비어 있으면 NULL. */
+static struct thread *
+rq_pick (struct runqueue *rq) {
+	struct thread *t;
+
+	if (rq->mask == 0)
+		return NULL;
+	t = list_entry (list_front (&rq->queue[rq_max_priority (rq)]),
+			struct thread, elem);
+	rq_delete (rq, t);
+	return t;
+}
+
+/* 비어 있지 않은 큐 중 가장 높은 우선순위. RQ가 비어 있으면 -1. */
+static int
+rq_max_priority (struct runqueue *rq) {
+	if (rq->mask == 0)
+		return -1;
+	return 63 - __builtin_clzll (rq->mask);
+}
+
+/* 스케줄링 클래스가 고른 다음 스레드를 RQ에서 꺼낸다.
+   RQ가 비어 있으면 NULL. */
+static struct thread *
+rq_pop (struct runqueue *rq) {
+	struct thread *t;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	t = sched_class->pick_next (rq);
+	if (t != NULL)
+		rq->cnt--;
+	return t;
+}
+
+/* T를 ready 큐에 넣는다.  큐 안의 위치는 스케줄링 클래스가 정한다. */
+static void
+ready_push (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	sched_class->enqueue (&ready_rq, t);
+	ready_rq.cnt++;
+}
+
+/* T의 우선순위를 PRIORITY로 바꾼다. T가 ready 큐에 있으면 새 우선순위의
+   큐로 옮겨서 큐 번호와 priority가 어긋나지 않게 한다.  T가 semaphore,
+   condition, lock의 대기 힙에 들어 있으면 그 위치도 함께 고친다. */
+void
+thread_update_priority (struct thread *t, int priority) {
+	enum intr_level old_level;
+
+	if (t->priority == priority)
+		return;
+
+	old_level = intr_disable ();
+	if (t->status == THREAD_READY) {
+		sched_class->dequeue (&ready_rq, t);
+		t->priority = priority;
+		sched_class->enqueue (&ready_rq, t);
+	} else
+		t->priority = priority;
+
+	/* 대기 중인 큐들이 새 우선순위를 반영하도록 힙 위치를 고친다. */
+	if (t->wait_heap != NULL)
+		heap_update (t->wait_heap, &t->wait_elem);
+	if (t->cond_heap != NULL)
+		heap_update (t->cond_heap, t->cond_elem);
+	if (t->wait_on_lock != NULL)
+		heap_update (&t->wait_on_lock->waiters, &t->lock_elem);
+	intr_set_level (old_level);
 }
 
 /* Use iretq to launch the thread */
@@ -583,73 +1013,23 @@ do_iret (struct intr_frame *tf) {
 			: : "g" ((uint64_t) tf) : "memory");
 }
 
-/* Switching the thread by activating the new thread's page
-   tables, and, if the previous thread is dying, destroying it.
+/* Switches to thread TH.  The new thread's page tables are
+   already activated by schedule().
 
-   At this function's invocation, we just switched from thread
-   PREV, the new thread is already running, and interrupts are
-   still disabled.
+   Every switch happens in kernel mode with interrupts off, so only
+   the callee-saved registers and the stack pointer are saved; see
+   switch.S.  iretq is needed only on the first entry to user mode,
+   which process.c does through do_iret().
 
    It's not safe to call printf() until the thread switch is
-   complete.  In practice that means that printf()s should be
-   added at the end of the function. */
+   complete. */
 static void
 thread_launch (struct thread *th) {
-	uint64_t tf_cur = (uint64_t) &running_thread ()->tf;
-	uint64_t tf = (uint64_t) &th->tf;
+	struct thread *curr = running_thread ();
+
 	ASSERT (intr_get_level () == INTR_OFF);
 
-	/* The main switching logic.
-	 * We first restore the whole execution context into the intr_frame
-	 * and then switching to the next thread by calling do_iret.
-	 * Note that, we SHOULD NOT use any stack from here
-	 * until switching is done. */
-	__asm __volatile (
-			/* Store registers that will be used. */
-			"push %%rax\n"
-			"push %%rbx\n"
-			"push %%rcx\n"
-			/* Fetch input once */
-			"movq %0, %%rax\n"
-			"movq %1, %%rcx\n"
-			"movq %%r15, 0(%%rax)\n"
-			"movq %%r14, 8(%%rax)\n"
-			"movq %%r13, 16(%%rax)\n"
-			"movq %%r12, 24(%%rax)\n"
-			"movq %%r11, 32(%%rax)\n"
-			"movq %%r10, 40(%%rax)\n"
-			"movq %%r9, 48(%%rax)\n"
-			"movq %%r8, 56(%%rax)\n"
-			"movq %%rsi, 64(%%rax)\n"
-			"movq %%rdi, 72(%%rax)\n"
-			"movq %%rbp, 80(%%rax)\n"
-			"movq %%rdx, 88(%%rax)\n"
-			"pop %%rbx\n"              // Saved rcx
-			"movq %%rbx, 96(%%rax)\n"
-			"pop %%rbx\n"              // Saved rbx
-			"movq %%rbx, 104(%%rax)\n"
-			"pop %%rbx\n"              // Saved rax
-			"movq %%rbx, 112(%%rax)\n"
-			"addq $120, %%rax\n"
-			"movw %%es, (%%rax)\n"
-			"movw %%ds, 8(%%rax)\n"
-			"addq $32, %%rax\n"
-			"call __next\n"         // read the current rip.
-			"__next:\n"
-			"pop %%rbx\n"
-			"addq $(out_iret -  __next), %%rbx\n"
-			"movq %%rbx, 0(%%rax)\n" // rip
-			"movw %%cs, 8(%%rax)\n"  // cs
-			"pushfq\n"
-			"popq %%rbx\n"
-			"mov %%rbx, 16(%%rax)\n" // eflags
-			"mov %%rsp, 24(%%rax)\n" // rsp
-			"movw %%ss, 32(%%rax)\n"
-			"mov %%rcx, %%rdi\n"
-			"call do_iret\n"
-			"out_iret:\n"
-			: : "g"(tf_cur), "g" (tf) : "memory"
-			);
+	switch_threads (&curr->switch_rsp, th->switch_rsp);
 }
 
 /* Schedules a new process. At entry, interrupts must be off.
@@ -660,11 +1040,8 @@ static void
 do_schedule(int status) {
 	ASSERT (intr_get_level () == INTR_OFF);
 	ASSERT (thread_current()->status == THREAD_RUNNING);
-	while (!list_empty (&destruction_req)) {
-		struct thread *victim =
-			list_entry (list_pop_front (&destruction_req), struct thread, elem);
-		palloc_free_page(victim);
-	}
+	if (!list_empty (&destruction_req))
+		thread_page_reclaim ();
 	thread_current ()->status = status;
 	schedule ();
 }
@@ -677,6 +1054,13 @@ schedule (void) {
 	ASSERT (intr_get_level () == INTR_OFF);
 	ASSERT (curr->status != THREAD_RUNNING);
 	ASSERT (is_thread (next));
+
+	/* idle에서 빠져나가는 길이면 tickless one-shot을 끝내고 그동안
+	   흐른 tick을 정산한다.  hlt를 깨운 인터럽트가 다른 스레드를 깨워
+	   intr_yield_on_return()으로 곧장 넘어가는 경우도 여기를 지난다. */
+	if (curr == idle_thread)
+		timer_idle_exit ();
+
 	/* Mark us as running. */
 	next->status = THREAD_RUNNING;
 
@@ -707,6 +1091,57 @@ schedule (void) {
 	}
 }
 
+/* 스레드 페이지 하나를 돌려준다.  캐시에 있으면 그것을, 없으면
+   palloc에서 새로 받는다.  내용은 0이 아닐 수 있으며 init_thread()가
+   struct thread 부분을 초기화한다.  실패하면 NULL. */
+static struct thread *
+thread_page_get (void) {
+	struct thread *t = NULL;
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	if (thread_cache_cnt > 0) {
+		t = thread_cache[--thread_cache_cnt];
+		thread_pages_reused++;
+	}
+	intr_set_level (old_level);
+
+	if (t == NULL) {
+		t = palloc_get_page (0);
+		if (t != NULL)
+			thread_pages_allocated++;
+	}
+	return t;
+}
+
+/* destruction_req에 쌓인 죽은 스레드 페이지를 한꺼번에 거둔다.
+   캐시에 자리가 있는 만큼 넣고 나머지는 palloc에 돌려준다.
+   캐시에 넣는 페이지는 struct thread 부분을 0xcc로 채워 magic을
+   지우므로, 죽은 스레드를 가리키는 포인터는 is_thread()에 걸린다.
+   인터럽트가 꺼진 채로 do_schedule()에서 호출된다. */
+static void
+thread_page_reclaim (void) {
+	struct list surplus;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	list_init (&surplus);
+	while (!list_empty (&destruction_req)) {
+		struct list_elem *e = list_pop_front (&destruction_req);
+		struct thread *t = list_entry (e, struct thread, elem);
+
+		if (thread_cache_cnt < THREAD_CACHE_MAX) {
+			memset (t, 0xcc, sizeof *t);
+			thread_cache[thread_cache_cnt++] = t;
+		} else
+			list_push_back (&surplus, e);
+	}
+
+	while (!list_empty (&surplus))
+		palloc_free_page (list_entry (list_pop_front (&surplus),
+					struct thread, elem));
+}
+
 /* Returns a tid to use for a new thread. */
 static tid_t
 allocate_tid (void) {
@@ -735,33 +1170,83 @@ void thread_sleep(int64_t ticks){
 	curr->weakeup_tick = ticks; /* 현재 선택한 스레드에 깨어날 시간을 설정한다. */
 
 	update_next_tick_to_awake(ticks); /* 모든 sleep 상태인 스레드 중 가장 빨리 깨어날 식간을 추적하기 위해 */
-	
-	list_push_back(&sleep_list, &curr->elem); /* sleep 리스트에 현재 스레드 정보를 제일 뒤에 추가한다.*/
+
+	/* sleep 힙에 현재 스레드를 넣는다. (O(1)) */
+	curr->sleep_child = NULL;
+	curr->sleep_sibling = NULL;
+	sleep_heap = sleep_heap_meld(sleep_heap, curr);
 
 	thread_block(); /* 현재 스레드를 block 상태로 만든다. */
 
 	intr_set_level(old_level); /* 중지시켰던 인터럽트를 다시 활성화 시킨다. */
 }
 
+/* 깨어날 시간이 TICKS 이하인 스레드를 힙의 루트에서부터 꺼내 깨운다.
+   깨울 스레드가 없는 sleeper는 건드리지 않는다. */
 void thread_awake(int64_t ticks){
-	next_tick_to_awake = INT64_MAX; /* 사료 가장 빠른 시간을 계산하기 위해 MAX 값을 사용 */
+	while (sleep_heap != NULL && sleep_heap->weakeup_tick <= ticks)
+		thread_unblock(sleep_heap_pop());
 
-	struct list_elem *e = list_begin(&sleep_list); /* 리스트의 시작점 부터 순회 준비 */
+	/* 남은 스레드 중 가장 빠른 시간은 힙의 루트다. */
+	next_tick_to_awake = sleep_heap != NULL ? sleep_heap->weakeup_tick : INT64_MAX;
+}
+
+/* 두 pairing heap A, B를 합친다. 루트 키가 큰 쪽이 작은 쪽의 첫 자식이
+   된다. A와 B는 형제가 없는 루트여야 한다. */
+static struct thread *
+sleep_heap_meld (struct thread *a, struct thread *b) {
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+	if (b->weakeup_tick < a->weakeup_tick) {
+		struct thread *tmp = a;
+		a = b;
+		b = tmp;
+	}
+	b->sleep_sibling = a->sleep_child;
+	a->sleep_child = b;
+	return a;
+}
+
+/* 힙의 루트(가장 빨리 깨어날 스레드)를 떼어내 반환한다.
+   자식들은 two-pass pairing으로 다시 하나의 힙으로 합친다. */
+static struct thread *
+sleep_heap_pop (void) {
+	struct thread *root = sleep_heap;
+	struct thread *child = root->sleep_child;
+	struct thread *pairs = NULL;
 
-	while (e != list_end(&sleep_list)){ /* sleep_list 전체를 돌면서 깰 스레드 확인 */
-		/* 현재 리스트 노드로부터 스레드를 역추적 (elem이 thread 내부에 있으므로 list_entry 매크로 사용) */
-		struct thread *t = list_entry(e, struct thread, elem);
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	/* 1st pass: 왼쪽부터 두 개씩 합쳐 역순 리스트로 모은다. */
+	while (child != NULL) {
+		struct thread *a = child;
+		struct thread *b = a->sleep_sibling;
 
-		if (t->weakeup_tick <= ticks){ /* 깨어날 시간이 된 경우 */
-			e = list_remove(e); // 리스트에서 제거
-			thread_unblock(t); // Ready 상태로 복귀
-		} else{
-			e = list_next(e); // 다음 스레드로 이동
-			update_next_tick_to_awake(t->weakeup_tick); // 더빠른 tick을 추적하기 위해 갱신
+		if (b == NULL)
+			child = NULL;
+		else {
+			child = b->sleep_sibling;
+			b->sleep_sibling = NULL;
 		}
-		
+		a->sleep_sibling = NULL;
+		a = sleep_heap_meld(a, b);
+		a->sleep_sibling = pairs;
+		pairs = a;
 	}
-	
+
+	/* 2nd pass: 오른쪽(리스트 앞)부터 차례로 합친다. */
+	sleep_heap = NULL;
+	while (pairs != NULL) {
+		struct thread *next = pairs->sleep_sibling;
+		pairs->sleep_sibling = NULL;
+		sleep_heap = sleep_heap_meld(sleep_heap, pairs);
+		pairs = next;
+	}
+
+	root->sleep_child = NULL;
+	return root;
 }
 
 void update_next_tick_to_awake(int64_t ticks){
@@ -785,24 +1270,59 @@ bool cmp_priority (const struct list_elem *a, const struct list_elem *b)
     return t1->priority > t2->priority; // 첫번째 우선순위가 2번째 스레드 우선순위보다 높으면 True(1), 아니면 False(0)
 }
 
-bool cmp_donation_priority (const struct list_elem *a, const struct list_elem *b)
+/* LOCK을 기다리는 스레드 중 가장 높은 우선순위.  대기자가 없으면
+   어떤 우선순위보다도 낮은 PRI_MIN - 1을 돌려준다. */
+static int
+lock_priority (const struct lock *lock)
 {
-    const struct thread *t1 = list_entry (a, struct thread, donations_elem);	
-    const struct thread *t2 = list_entry (b, struct thread, donations_elem);	
-	if (t1 == NULL || t2 == NULL)
-		return false;
-    return t1->priority > t2->priority; // 첫번째 우선순위가 2번째 스레드 우선순위보다 높으면 True(1), 아니면 False(0)
+    struct heap_elem *top = heap_top (&lock->waiters);
+
+    if (top == NULL)
+        return PRI_MIN - 1;
+    return heap_entry (top, struct thread, lock_elem)->priority;
+}
+
+/* lock->waiters 힙의 비교 함수: 스레드 우선순위 순. */
+bool cmp_waiter_priority (const struct heap_elem *a, const struct heap_elem *b,
+                          void *aux UNUSED)
+{
+    return heap_entry (a, struct thread, lock_elem)->priority
+           < heap_entry (b, struct thread, lock_elem)->priority;
 }
 
+/* held_locks 힙의 비교 함수: 각 락의 최고 대기자 우선순위 순. */
+bool cmp_lock_priority (const struct heap_elem *a, const struct heap_elem *b,
+                        void *aux UNUSED)
+{
+    return lock_priority (heap_entry (a, struct lock, elem))
+           < lock_priority (heap_entry (b, struct lock, elem));
+}
+
+/* T가 가져야 할 우선순위: 원래 우선순위와 T가 가진 락들의 최고
+   대기자 우선순위 중 큰 값.  held_locks 힙의 top만 보면 된다. */
+static int
+effective_priority (struct thread *t)
+{
+    int priority = t->init_priority;
+    struct heap_elem *top = heap_top (&t->held_locks);
+
+    if (priority < t->rw_donated)
+        priority = t->rw_donated;
+
+    if (top != NULL) {
+        int donated = lock_priority (heap_entry (top, struct lock, elem));
+        if (priority < donated)
+            priority = donated;
+    }
+    return priority;
+}
 
 // 현재와 가장 높은 우선 순위 비교
 void cmp_nowNfirst (void){
-    if (list_empty(&ready_list))
+    if (ready_rq.cnt == 0)
         return;
  
-    struct thread *th = list_entry(list_front(&ready_list), struct thread, elem);
- 
-    if (thread_current()->priority < th->priority){
+    if (sched_class->yield_check(&ready_rq, thread_current())){
         if (intr_context())
             intr_yield_on_return();
         else
@@ -810,68 +1330,84 @@ void cmp_nowNfirst (void){
 	}
 }
 
-void donation_priority(void){
-    struct thread *t = thread_current();
-    int priority = t->priority;
+/* T가 wait_on_lock을 기다리는 중에 T의 우선순위가 올랐을 때 호출한다.
+   대기 사슬을 따라 올라가며 각 소유자의 held_locks 힙에서 락의 위치를
+   고치고 우선순위를 다시 계산한다.  우선순위가 바뀌지 않은 소유자에서
+   멈추므로 사슬 한 단계는 O(log n)이다.  인터럽트가 꺼진 상태여야 한다. */
+static void
+donate_chain (struct thread *t)
+{
     int depth;
 
-    for (depth = 0; depth < 8; depth++) {
-        if (t->wait_on_lock == NULL)
-            break;
+    ASSERT (intr_get_level () == INTR_OFF);
 
-        struct thread *holder = t->wait_on_lock->holder;
-        if (holder == NULL)
+    for (depth = 0; depth < MAX_DONATION_DEPTH; depth++) {
+        struct lock *lock = t->wait_on_lock;
+        struct thread *holder;
+        int priority;
+
+        if (lock == NULL || lock->holder == NULL)
             break;
 
-        if (holder->priority < priority)
-            holder->priority = priority;
+        holder = lock->holder;
+        heap_update (&holder->held_locks, &lock->elem);
+
+        priority = effective_priority (holder);
+        if (priority == holder->priority)
+            break;
 
+        thread_update_priority (holder, priority);
         t = holder;
     }
 }
 
-bool list_contains(struct list *list, struct list_elem *elem) {
-    struct list_elem *e;
-    for (e = list_begin(list); e != list_end(list); e = list_next(e)) {
-        if (e == elem) return true;
-    }
-    return false;
-
+/* 현재 스레드가 wait_on_lock->waiters에 들어간 직후에 호출한다. */
+void donation_priority(void){
+    donate_chain (thread_current ());
 }
 
-
-// donations 리스트에서 가장 높은 우선순위로 복원
+/* 현재 스레드의 우선순위를 원래 우선순위와 가진 락들의 대기자로부터
+   다시 계산한다.  락을 얻거나 놓은 뒤, 또는 원래 우선순위가 바뀐 뒤에
+   호출한다. */
 void refresh_priority(void){
 	struct thread *t = thread_current();
-    t->priority = t->init_priority;
- 
-    if (list_empty(&t->donations))
+    enum intr_level old_level = intr_disable ();
+
+    thread_update_priority(t, effective_priority (t));
+    intr_set_level (old_level);
+}
+
+/* 읽기로 rwlock을 잡고 있는 T에게, 그 rwlock의 쓰기를 기다리는
+   스레드의 우선순위 PRIORITY를 기부한다.  기부는 T가 잡은 읽기를
+   모두 놓을 때까지 유지된다.  인터럽트가 꺼진 상태여야 한다. */
+void
+thread_rw_donate (struct thread *t, int priority)
+{
+    ASSERT (intr_get_level () == INTR_OFF);
+
+    if (t->rw_donated >= priority)
         return;
- 
-    list_sort(&t->donations, cmp_priority, NULL);
- 
-    struct list_elem *max_elem = list_front(&t->donations);
-    struct thread *max_thread = list_entry(max_elem, struct thread, donations_elem);
- 
-    if (t->priority < max_thread->priority)
-        t->priority = max_thread->priority;
+    t->rw_donated = priority;
+    if (effective_priority (t) != t->priority)
+        thread_update_priority (t, effective_priority (t));
+
+    /* 읽기를 잡은 채 락을 기다리는 중이면 그 락의 소유자에게도
+       기부가 이어져야 한다. */
+    if (t->wait_on_lock != NULL)
+        donate_chain (t);
 }
 
+/* 현재 스레드가 마지막 읽기를 놓았을 때 rwlock 대기자에게서 받은
+   기부를 거둔다. */
+void
+thread_rw_restore (void)
+{
+    struct thread *t = thread_current ();
 
-void remove_with_lock(struct lock *lock){
-	struct thread *t = thread_current();
-    struct list_elem *curr = list_begin(&t->donations);
-    struct thread *curr_thread = NULL;
- 
-	while (curr != list_end(&t->donations)) 
-	{
-        curr_thread = list_entry(curr, struct thread, donations_elem);
- 
-        if (curr_thread->wait_on_lock == lock)
-            list_remove(&curr_thread->donations_elem);
- 
-        curr = list_next(curr);
-    }
+    if (t->rw_donated < 0)
+        return;
+    t->rw_donated = -1;
+    refresh_priority ();
 }
 
 /* recent_cpu와 nice 값을 이용해서 priority 계산진행 */
@@ -881,7 +1417,25 @@ mlfqs_priority (struct thread *t)
     if (t == idle_thread)
         return;
 	/* priority = PRI_MAX – (recent_cpu / 4) – (nice * 2) */
-    t->priority = fp_to_int(add_mixed(div_mixed(t->recent_cpu, -4), PRI_MAX - t->niceness * 2));
+    int priority = fp_to_int(add_mixed(div_mixed(t->recent_cpu, -4), PRI_MAX - t->niceness * 2));
+
+	/* ready 큐 인덱스로 쓰이므로 범위를 벗어나지 않게 자른다. */
+	if (priority < PRI_MIN)
+		priority = PRI_MIN;
+	else if (priority > PRI_MAX)
+		priority = PRI_MAX;
+    thread_update_priority(t, priority);
+}
+
+/* T의 recent_cpu가 바뀌었음을 기록한다. 다음 4틱 경계에서 우선순위가
+   다시 계산된다. */
+static void
+mlfqs_mark_dirty (struct thread *t)
+{
+    if (!t->mlfqs_dirty) {
+        t->mlfqs_dirty = true;
+        list_push_back(&mlfqs_dirty_list, &t->dirty_elem);
+    }
 }
 
 /* recent_cpu 값 계산 */
@@ -898,35 +1452,39 @@ mlfqs_recent_cpu (struct thread *t)
     t->recent_cpu = add_mixed(mult_fp(div_fp(mult_mixed(load_avg, 2), add_mixed(mult_mixed(load_avg, 2), 1)), t->recent_cpu), t->niceness);
 }
 
-/* all_list에 있는 모든 스레드의 recent_cpu 값 재계산 */
+/* 1초마다 all_list에 있는 모든 스레드의 recent_cpu를 한 번에 감쇠시킨다.
+   decay 계수는 스레드마다 다시 나누지 않고 한 번만 계산하고, 값이 실제로
+   바뀐 스레드만 우선순위 재계산 대상으로 표시한다. */
 void 
 mlfqs_recalc_recent_cpu (void) 
 {
-    struct list_elem *e = list_begin(&all_list);
-    struct thread *t = NULL;
+    int decay = div_fp(mult_mixed(load_avg, 2), add_mixed(mult_mixed(load_avg, 2), 1));
+    struct list_elem *e;
 
-	// 밤복문 돌며 MLFQ recent_cpu 재계산
-    while (e != list_end(&all_list)) {
-        t = list_entry(e, struct thread, all_elem);
-        mlfqs_recent_cpu(t);
+    for (e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e)) {
+        struct thread *t = list_entry(e, struct thread, all_elem);
+        int recent_cpu;
 
-        e = list_next(e);
+        if (t == idle_thread)
+            continue;
+
+        recent_cpu = add_mixed(mult_fp(decay, t->recent_cpu), t->niceness);
+        if (recent_cpu != t->recent_cpu) {
+            t->recent_cpu = recent_cpu;
+            mlfqs_mark_dirty(t);
+        }
     }
 }
 
 
-/* all_list에 있는 스레드들 우선순위 재계산 */
+/* recent_cpu가 바뀐 스레드들만 우선순위 재계산 */
 void mlfqs_recalc_priority (void) 
 {
-    struct list_elem *e = list_begin(&all_list);
-    struct thread *t = NULL;
-
-	// 반복문 돌며 MLFQ 우선순위 계산 진행
-    while (e != list_end(&all_list)) {
-        t = list_entry(e, struct thread, all_elem);
+    while (!list_empty(&mlfqs_dirty_list)) {
+        struct thread *t = list_entry(list_pop_front(&mlfqs_dirty_list),
+                                      struct thread, dirty_elem);
+        t->mlfqs_dirty = false;
         mlfqs_priority(t);
-
-        e = list_next(e);
     }
 }
 
@@ -936,7 +1494,7 @@ mlfqs_load_avg (void)
 {
     int ready_threads;
 
-    ready_threads = list_size(&ready_list);
+    ready_threads = ready_rq.cnt;
 
     if (thread_current() != idle_thread)
         ready_threads++;
@@ -949,10 +1507,12 @@ mlfqs_load_avg (void)
 void 
 mlfqs_increment (void) 
 {
-    if (thread_current() == idle_thread)
+    struct thread *t = thread_current();
+
+    if (t == idle_thread)
         return;
 
 	/* recent_cpu 값 1증가 */
-    thread_current()->recent_cpu = add_mixed(thread_current()->recent_cpu, 1);
+    t->recent_cpu = add_mixed(t->recent_cpu, 1);
+    mlfqs_mark_dirty(t);
 }
-
@@ -0,0 +1,285 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Number of worker threads in the pool. */
+#define WORKER_CNT 4
+
+/* All workqueues, highest priority first. */
+static struct list queues;
+
+/* Upped once for every item queued.  An item cancelled before a
+   worker took it leaves an extra count behind, which just makes
+   some worker wake up, find nothing and go back to sleep. */
+static struct semaphore work_ready;
+
+/* Armed delayed work, earliest expiry on top. */
+static struct heap timers;
+
+/* Earliest expiry in TIMERS, or INT64_MAX. */
+static int64_t next_expiry = INT64_MAX;
+
+struct workqueue system_wq;
+
+static bool initialized;
+
+static void worker_main (void *aux);
+static bool queue_less (const struct list_elem *, const struct list_elem *,
+                        void *aux);
+static bool timer_less (const struct heap_elem *, const struct heap_elem *,
+                        void *aux);
+static void update_next_expiry (void);
+
+/* Initializes the work queue subsystem, creates system_wq and
+   starts the worker pool.  Must be called after thread_start(). */
+void
+workqueue_init (void) {
+	int i;
+
+	list_init (&queues);
+	sema_init (&work_ready, 0);
+	heap_init (&timers, timer_less, NULL);
+	initialized = true;
+
+	workqueue_create (&system_wq, "events", PRI_DEFAULT);
+
+	for (i = 0; i < WORKER_CNT; i++) {
+		char name[16];
+
+		snprintf (name, sizeof name, "kworker/%d", i);
+		if (thread_create (name, PRI_DEFAULT, worker_main, NULL) == TID_ERROR)
+			PANIC ("can't start worker thread");
+	}
+}
+
+/* Initializes WQ as an empty queue named NAME whose items run at
+   PRIORITY, and makes it visible to the workers. */
+void
+workqueue_create (struct workqueue *wq, const char *name, int priority) {
+	enum intr_level old_level;
+
+	ASSERT (initialized);
+	ASSERT (wq != NULL);
+	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+	wq->name = name;
+	wq->priority = priority;
+	wq->run_cnt = 0;
+	list_init (&wq->pending);
+
+	old_level = intr_disable ();
+	list_insert_ordered (&queues, &wq->elem, queue_less, NULL);
+	intr_set_level (old_level);
+}
+
+/* Prints the number of items each queue has run. */
+void
+workqueue_print_stats (void) {
+	struct list_elem *e;
+
+	if (!initialized)
+		return;
+	printf ("Workqueues:");
+	for (e = list_begin (&queues); e != list_end (&queues); e = list_next (e)) {
+		struct workqueue *wq = list_entry (e, struct workqueue, elem);
+		printf (" %s %llu", wq->name, wq->run_cnt);
+	}
+	printf (" items run\n");
+}
+
+/* Initializes W to call FUNC (W) with W->aux set to AUX. */
+void
+work_init (struct work *w, work_func *func, void *aux) {
+	ASSERT (w != NULL);
+	ASSERT (func != NULL);
+
+	w->func = func;
+	w->aux = aux;
+	w->wq = NULL;
+}
+
+/* Queues W on WQ.  Returns false, doing nothing, if W is already
+   pending. */
+bool
+queue_work (struct workqueue *wq, struct work *w) {
+	enum intr_level old_level;
+	bool queued = false;
+
+	ASSERT (wq != NULL);
+	ASSERT (w != NULL);
+
+	old_level = intr_disable ();
+	if (w->wq == NULL) {
+		w->wq = wq;
+		list_push_back (&wq->pending, &w->elem);
+		sema_up (&work_ready);
+		queued = true;
+	}
+	intr_set_level (old_level);
+	return queued;
+}
+
+/* Removes W from its queue if no worker has taken it yet.
+   Returns true if W was pending.  Does not wait for a W that is
+   already running. */
+bool
+cancel_work (struct work *w) {
+	enum intr_level old_level;
+	bool pending;
+
+	ASSERT (w != NULL);
+
+	old_level = intr_disable ();
+	pending = w->wq != NULL;
+	if (pending) {
+		list_remove (&w->elem);
+		w->wq = NULL;
+	}
+	intr_set_level (old_level);
+	return pending;
+}
+
+/* Initializes DW to call FUNC (&DW->work) with DW->work.aux set
+   to AUX. */
+void
+delayed_work_init (struct delayed_work *dw, work_func *func, void *aux) {
+	ASSERT (dw != NULL);
+
+	work_init (&dw->work, func, aux);
+	dw->wq = NULL;
+}
+
+/* Queues DW on WQ once TICKS timer ticks have passed, or right
+   away if TICKS <= 0.  Returns false, doing nothing, if DW is
+   already armed or pending. */
+bool
+queue_delayed_work (struct workqueue *wq, struct delayed_work *dw,
+                    int64_t ticks) {
+	enum intr_level old_level;
+	bool queued = false;
+
+	ASSERT (wq != NULL);
+	ASSERT (dw != NULL);
+
+	if (ticks <= 0)
+		return queue_work (wq, &dw->work);
+
+	old_level = intr_disable ();
+	if (dw->wq == NULL && dw->work.wq == NULL) {
+		dw->wq = wq;
+		dw->expires = timer_ticks () + ticks;
+		heap_insert (&timers, &dw->timer_elem);
+		update_next_expiry ();
+		queued = true;
+	}
+	intr_set_level (old_level);
+	return queued;
+}
+
+/* Disarms DW or removes it from its queue, whichever applies.
+   Returns true if DW had not started running yet. */
+bool
+cancel_delayed_work (struct delayed_work *dw) {
+	enum intr_level old_level;
+	bool armed;
+
+	ASSERT (dw != NULL);
+
+	old_level = intr_disable ();
+	armed = dw->wq != NULL;
+	if (armed) {
+		heap_remove (&timers, &dw->timer_elem);
+		dw->wq = NULL;
+		update_next_expiry ();
+	}
+	intr_set_level (old_level);
+	return cancel_work (&dw->work) || armed;
+}
+
+/* Called by the timer interrupt handler at tick NOW.  Queues all
+   delayed work that has expired. */
+void
+workqueue_timer (int64_t now) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (next_expiry <= now) {
+		struct delayed_work *dw = heap_entry (heap_pop (&timers),
+				struct delayed_work, timer_elem);
+		struct workqueue *wq = dw->wq;
+
+		dw->wq = NULL;
+		queue_work (wq, &dw->work);
+		update_next_expiry ();
+	}
+}
+
+/* Returns the tick at which the next delayed work expires, or
+   INT64_MAX if none is armed. */
+int64_t
+workqueue_next_expiry (void) {
+	return next_expiry;
+}
+
+/* Worker thread.  Runs pending items from the highest priority
+   queue, at that queue's priority. */
+static void
+worker_main (void *aux UNUSED) {
+	for (;;) {
+		struct workqueue *wq = NULL;
+		struct work *w = NULL;
+		enum intr_level old_level;
+		struct list_elem *e;
+
+		sema_down (&work_ready);
+
+		old_level = intr_disable ();
+		for (e = list_begin (&queues); e != list_end (&queues); e = list_next (e)) {
+			wq = list_entry (e, struct workqueue, elem);
+			if (!list_empty (&wq->pending)) {
+				w = list_entry (list_pop_front (&wq->pending), struct work, elem);
+				w->wq = NULL;
+				wq->run_cnt++;
+				break;
+			}
+		}
+		intr_set_level (old_level);
+
+		if (w == NULL)
+			continue;
+		thread_set_priority (wq->priority);
+		w->func (w);
+	}
+}
+
+/* Orders queues by priority, highest first. */
+static bool
+queue_less (const struct list_elem *a_, const struct list_elem *b_,
+            void *aux UNUSED) {
+	const struct workqueue *a = list_entry (a_, struct workqueue, elem);
+	const struct workqueue *b = list_entry (b_, struct workqueue, elem);
+
+	return a->priority > b->priority;
+}
+
+/* Orders delayed work so that the earliest expiry is greatest. */
+static bool
+timer_less (const struct heap_elem *a_, const struct heap_elem *b_,
+            void *aux UNUSED) {
+	const struct delayed_work *a = heap_entry (a_, struct delayed_work, timer_elem);
+	const struct delayed_work *b = heap_entry (b_, struct delayed_work, timer_elem);
+
+	return a->expires > b->expires;
+}
+
+/* Recomputes next_expiry from TIMERS.  Interrupts must be off. */
+static void
+update_next_expiry (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	next_expiry = heap_empty (&timers) ? INT64_MAX
+		: heap_entry (heap_top (&timers), struct delayed_work, timer_elem)->expires;
+}
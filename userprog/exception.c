@@ -4,6 +4,7 @@
 #include "userprog/gdt.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "userprog/syscall.h"
 #include "intrinsic.h"
 
 /* Number of page faults processed. */
@@ -70,7 +71,6 @@ void exception_print_stats(void)
 static void
 kill(struct intr_frame *f)
 {
-	struct thread *t = thread_current();
 	/* This interrupt is one (probably) caused by a user process.
 		 For example, the process might have tried to access unmapped
 		 virtual memory (a page fault).  For now, we simply kill the
@@ -86,9 +86,7 @@ kill(struct intr_frame *f)
 	case SEL_UCSEG:
 		/* User's code segment, so it's a user exception, as we
 			 expected.  Kill the user process.  */
-		printf("%s: exit(-1)\n", t->name);
-		t->exit_status = -1;
-		thread_exit();
+		exit(-1);
 
 	case SEL_KCSEG:
 		/* Kernel's code segment, which indicates a kernel bug.
@@ -0,0 +1,128 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <list.h>
+#include <stdint.h>
+#include "threads/synch.h"
+
+/* Fast user-space mutexes.
+ *
+ * A futex is just an int in user memory.  User code manipulates
+ * it with atomic instructions and only enters the kernel when it
+ * has to sleep (futex_wait) or has to wake a sleeper
+ * (futex_wake), so an uncontended lock never makes a system
+ * call.
+ *
+ * Waiters are kept in a small hash table keyed by the process
+ * (its leader thread) and the user address.  Each bucket has its
+ * own lock, and futex_wait() compares *UADDR with the expected
+ * value while holding it, so a wake that happens between the
+ * user's check and the sleep cannot be lost. */
+
+#define FUTEX_BUCKETS 64
+
+/* One sleeping thread. */
+struct futex_waiter {
+	struct list_elem elem;          /* Bucket list element. */
+	struct thread *leader;          /* Process of the waiter. */
+	int *uaddr;                     /* Futex word. */
+	struct semaphore sema;          /* Upped to wake the waiter. */
+};
+
+/* Hash bucket. */
+struct futex_bucket {
+	struct lock lock;               /* Protects waiters. */
+	struct list waiters;            /* List of struct futex_waiter. */
+};
+
+static struct futex_bucket buckets[FUTEX_BUCKETS];
+
+/* Returns the bucket for UADDR in the process led by LEADER. */
+static struct futex_bucket *
+bucket_of (struct thread *leader, int *uaddr) {
+	uintptr_t key = ((uintptr_t) uaddr >> 2) ^ ((uintptr_t) leader >> 12);
+
+	return &buckets[key % FUTEX_BUCKETS];
+}
+
+/* Initializes the futex hash table. */
+void
+futex_init (void) {
+	for (int i = 0; i < FUTEX_BUCKETS; i++) {
+		lock_init (&buckets[i].lock);
+		list_init (&buckets[i].waiters);
+	}
+}
+
+/* Sleeps until woken by futex_wake() on UADDR, as long as *UADDR
+   still equals VAL.  Returns 0 after a wakeup, or -1 without
+   sleeping if *UADDR has already changed or the process is
+   exiting.  UADDR must be a
+   valid, aligned user address. */
+int
+futex_wait (int *uaddr, int val) {
+	struct thread *leader = thread_current ()->leader;
+	struct futex_bucket *b = bucket_of (leader, uaddr);
+	struct futex_waiter w;
+
+	lock_acquire (&b->lock);
+	if (leader->exiting || *(volatile int *) uaddr != val) {
+		lock_release (&b->lock);
+		return -1;
+	}
+	w.leader = leader;
+	w.uaddr = uaddr;
+	sema_init (&w.sema, 0);
+	list_push_back (&b->waiters, &w.elem);
+	lock_release (&b->lock);
+
+	sema_down (&w.sema);
+	return 0;
+}
+
+/* Wakes up to CNT threads sleeping on UADDR in the current
+   process, oldest first.  Returns the number woken. */
+int
+futex_wake (int *uaddr, int cnt) {
+	struct thread *leader = thread_current ()->leader;
+	struct futex_bucket *b = bucket_of (leader, uaddr);
+	struct list_elem *e;
+	int woken = 0;
+
+	lock_acquire (&b->lock);
+	for (e = list_begin (&b->waiters);
+	     e != list_end (&b->waiters) && woken < cnt; ) {
+		struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+
+		e = list_next (e);
+		if (w->leader == leader && w->uaddr == uaddr) {
+			list_remove (&w->elem);
+			sema_up (&w->sema);
+			woken++;
+		}
+	}
+	lock_release (&b->lock);
+	return woken;
+}
+
+/* Wakes every thread of the process led by LEADER that sleeps on
+   any futex.  Called when the process exits so that its threads
+   can notice and terminate. */
+void
+futex_wake_all (struct thread *leader) {
+	for (int i = 0; i < FUTEX_BUCKETS; i++) {
+		struct futex_bucket *b = &buckets[i];
+		struct list_elem *e;
+
+		lock_acquire (&b->lock);
+		for (e = list_begin (&b->waiters); e != list_end (&b->waiters); ) {
+			struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+
+			e = list_next (e);
+			if (w->leader == leader) {
+				list_remove (&w->elem);
+				sema_up (&w->sema);
+			}
+		}
+		lock_release (&b->lock);
+	}
+}
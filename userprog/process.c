@@ -13,12 +13,14 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
 #include "lib/string.h"
 #include "userprog/syscall.h"
+#include "userprog/futex.h"
 
 #include "lib/stdio.h"
 #include "intrinsic.h"
@@ -28,10 +30,52 @@
 #include "vm/vm.h"
 #endif
 
+/* 부모와 자식 프로세스가 함께 가지는 종료 기록.  자식은 종료하자마자
+ * struct thread 페이지를 돌려주고 종료 상태만 여기에 남긴다.
+ * 부모와 자식이 참조를 하나씩 가지며 늦게 놓는 쪽이 해제한다.
+ * 부모의 child_list와 tid로 찾는 child_table에 함께 들어 있고,
+ * 목록, 테이블, refcnt는 인터럽트를 끈 채 다룬다. */
+struct child_info
+{
+	tid_t tid;
+	struct thread *parent;        /* wait할 수 있는 스레드 */
+	int exit_status;
+	int refcnt;                   /* 아직 놓지 않은 쪽 수 (부모, 자식) */
+	bool fork_ok;                 /* fork의 복제가 성공했는지 */
+	struct semaphore forked;      /* fork의 복제가 끝나면 up */
+	struct semaphore exited;      /* 자식이 종료하면 up */
+	struct list_elem elem;        /* parent->child_list 연결 elem */
+	struct child_info *hash_next; /* child_table 버킷 연결 */
+};
+
+/* tid로 child_info를 찾는 해시 테이블.  tid는 재사용되지 않으므로
+ * 버킷에는 대개 하나만 들어 있다. */
+#define CHILD_TABLE_SIZE 256 /* 2의 거듭제곱 */
+static struct child_info *child_table[CHILD_TABLE_SIZE];
+
+/* process_spawn()이 새 스레드에게 넘기는 인자. */
+struct spawn_arg
+{
+	thread_func *function;
+	void *aux;
+	struct child_info *info;
+};
+
 static void process_cleanup(void);
 static bool load(const char *file_name, struct intr_frame *if_);
+static tid_t process_spawn(const char *name, thread_func *function, void *aux);
+static void spawn_start(void *);
+static struct child_info *get_child_process(tid_t tid);
+static void child_info_unlink(struct child_info *info);
+static void child_info_release(struct child_info *info);
+static void release_children(struct thread *t);
 static void initd(void *f_name);
 static void __do_fork(void *);
+static void uthread_start(void *);
+static void uthread_reap(struct thread *t);
+static bool fdt_grow(struct thread *t, int min_cap);
+static bool fdt_install(struct thread *t, int fd, struct file *f);
+static void fdt_destroy(struct thread *t);
 
 /* General process initializer for initd and other process. */
 static void
@@ -63,7 +107,7 @@ tid_t process_create_initd(const char *file_name)
 	// ~ Argument Passing
 
 	/* Create a new thread to execute FILE_NAME. */
-	tid = thread_create(file_name, PRI_DEFAULT, initd, fn_copy); // initd를 타고 들어가면
+	tid = process_spawn(file_name, initd, fn_copy); // initd를 타고 들어가면
 	if (tid == TID_ERROR)
 		palloc_free_page(fn_copy);
 	return tid;
@@ -92,15 +136,17 @@ tid_t process_fork(const char *name, struct intr_frame *if_ UNUSED)
 	// 직접 넘겨받은 intr_frame을 복사
 	memcpy(&curr->parent_if, if_, sizeof(struct intr_frame));
 
-	tid_t tid = thread_create(name, PRI_DEFAULT, __do_fork, curr);
+	tid_t tid = process_spawn(name, __do_fork, curr);
 
 	if (tid == TID_ERROR)
 		return TID_ERROR;
 
-	struct thread *child = get_child_process(tid);
-	sema_down(&child->fork_sema); // 자식이 준비될 때까지 기다림
+	/* 자식이 종료해도 기록은 남아 있으므로 그대로 기다려도 된다.
+	 * 복제에 실패한 자식은 wait하면 -1을 돌려준다. */
+	struct child_info *child = get_child_process(tid);
+	sema_down(&child->forked); // 자식이 준비될 때까지 기다림
 
-	if (child->exit_status == TID_ERROR)
+	if (!child->fork_ok)
 		return TID_ERROR;
 
 	return tid;
@@ -161,6 +207,7 @@ __do_fork(void *aux)
 	struct thread *current = thread_current();
 	/* TODO: somehow pass the parent_if. (i.e. process_fork()'s if_) */
 	struct intr_frame *parent_if = &parent->parent_if;
+	struct thread *proc = parent->leader; /* spt, FDT를 가진 스레드 */
 	bool succ = true;
 
 	/* 1. Read the cpu context to local stack. */
@@ -175,30 +222,31 @@ __do_fork(void *aux)
 	process_activate(current);
 #ifdef VM
 	supplemental_page_table_init(&current->spt);
-	if (!supplemental_page_table_copy(&current->spt, &parent->spt))
+	if (!supplemental_page_table_copy(&current->spt, &proc->spt))
 		goto error;
 #else
 	if (!pml4_for_each(parent->pml4, duplicate_pte, parent))
 		goto error;
 #endif
 
-	if (parent->fd_idx >= FDCOUNT_LIMIT)
-		goto error;
-
-	current->fd_idx = parent->fd_idx; // fdt 및 idx 복제
-	for (int fd = 3; fd < parent->fd_idx; fd++)
+	/* fdt 복제: 부모와 같은 번호에 파일을 복제해 넣는다. */
+	for (int fd = 3; fd < proc->fd_idx; fd++)
 	{
-		if (parent->fd_table[fd] == NULL)
+		struct file *f;
+
+		if (proc->fd_table[fd] == NULL)
 			continue;
-		current->fd_table[fd] = file_duplicate(parent->fd_table[fd]);
-		if (current->fd_table[fd] == NULL)
+		f = file_duplicate(proc->fd_table[fd]);
+		if (f == NULL)
+			goto error;
+		if (!fdt_install(current, fd, f))
 		{
+			file_close(f);
 			goto error;
 		}
 	}
-	lock_acquire(&filesys_lock);
-	sema_up(&current->fork_sema); // fork 프로세스가 정상적으로 완료됐으므로 현재 fork용 sema unblock
-	lock_release(&filesys_lock);
+	current->child_info->fork_ok = true;
+	sema_up(&current->child_info->forked); // fork 프로세스가 정상적으로 완료됐으므로 현재 fork용 sema unblock
 
 	process_init();
 
@@ -208,7 +256,7 @@ __do_fork(void *aux)
 
 error:
 
-	sema_up(&current->fork_sema); // 복제에 실패했으므로 현재 fork용 sema unblock
+	sema_up(&current->child_info->forked); // 복제에 실패했으므로 현재 fork용 sema unblock
 	exit(TID_ERROR);
 }
 
@@ -296,16 +344,19 @@ void argument_stack(char **argv, int argc, struct intr_frame *if_)
  */
 int process_wait(tid_t child_tid)
 {
-	struct thread *child = get_child_process(child_tid);
+	struct child_info *child = get_child_process(child_tid);
+	enum intr_level old_level;
+
 	if (child == NULL)
 		return -1;
 
-	sema_down(&child->wait_sema); // 자식 프로세스가 종료될 때 까지 대기.
+	sema_down(&child->exited); // 자식 프로세스가 종료될 때 까지 대기.
 
 	int exit_status = child->exit_status;
-	list_remove(&child->child_elem);
-
-	sema_up(&child->exit_sema); // 자식 프로세스가 죽을 수 있도록 signal
+	old_level = intr_disable();
+	child_info_unlink(child);
+	intr_set_level(old_level);
+	child_info_release(child);
 
 	return exit_status;
 }
@@ -314,17 +365,192 @@ int process_wait(tid_t child_tid)
 void process_exit(void)
 {
 	struct thread *curr = thread_current();
+
+	/* 유저 스레드는 leader의 자원을 함께 쓰므로 아무것도 해제하지 않는다.
+	 * leader가 pml4를 해제하기 전에 이 스레드가 그것을 쓰지 않도록
+	 * 커널 페이지 테이블로 옮긴 뒤 join을 기다린다. */
+	if (curr->leader != curr)
+	{
+		release_children(curr);
+		curr->pml4 = NULL;
+		pml4_activate(NULL);
+		sema_up(&curr->wait_sema);
+		sema_down(&curr->exit_sema);
+		return;
+	}
+
+	/* 공유 자원을 정리하기 전에 남은 유저 스레드를 모두 끝낸다.
+	 * join 중인 스레드도 목록에 남아 있는 어떤 스레드를 기다리고 있으므로
+	 * 목록이 비면 살아 있는 유저 스레드는 없다. */
+	curr->exiting = true;
+	if (!list_empty(&curr->uthread_list))
+		futex_wake_all(curr);
+	while (true)
+	{
+		struct thread *t = NULL;
+		enum intr_level old_level = intr_disable();
+
+		if (!list_empty(&curr->uthread_list))
+			t = list_entry(list_pop_front(&curr->uthread_list), struct thread, uthread_elem);
+		intr_set_level(old_level);
+
+		if (t == NULL)
+			break;
+		uthread_reap(t);
+	}
+
 	for (int fd = 0; fd < curr->fd_idx; fd++) // FDT 비우기
 		close(fd);
 
 	file_close(curr->running); // 현재 프로세스가 실행중인 파일 종료
 
-	palloc_free_multiple(curr->fd_table, FDT_PAGES);
+	fdt_destroy(curr);
 
 	process_cleanup();
 
-	sema_up(&curr->wait_sema);	 // 자식 프로세스가 종료될 때까지 대기하는 부모에게 signal
-	sema_down(&curr->exit_sema); // 부모 프로세스가 종료될 떄까지 대기
+	release_children(curr);
+
+	/* 종료 상태를 기록에 남기고 부모를 깨운다.  이 스레드의 페이지는
+	 * 부모의 wait를 기다리지 않고 곧바로 해제된다. */
+	if (curr->child_info != NULL)
+	{
+		struct child_info *info = curr->child_info;
+
+		curr->child_info = NULL;
+		info->exit_status = curr->exit_status;
+		sema_up(&info->exited);
+		child_info_release(info);
+	}
+}
+
+/* T가 기다리지 않은 자식들의 기록을 놓는다.  아직 살아 있는 자식은
+ * 종료할 때 남은 참조를 놓으며 기록을 해제한다. */
+static void
+release_children(struct thread *t)
+{
+	while (true)
+	{
+		struct child_info *child = NULL;
+		enum intr_level old_level = intr_disable();
+
+		if (!list_empty(&t->child_list))
+		{
+			child = list_entry(list_front(&t->child_list), struct child_info, elem);
+			child_info_unlink(child);
+		}
+		intr_set_level(old_level);
+
+		if (child == NULL)
+			break;
+		child_info_release(child);
+	}
+}
+
+/* 현재 스레드의 자식 프로세스로 NAME 스레드를 만들어 FUNCTION (AUX)를
+ * 실행한다.  자식의 종료 상태를 받을 child_info를 함께 만든다.
+ * 새 스레드의 tid를 반환하고, 실패하면 TID_ERROR를 반환한다. */
+static tid_t
+process_spawn(const char *name, thread_func *function, void *aux)
+{
+	struct thread *curr = thread_current();
+	struct child_info *info;
+	struct spawn_arg *sa;
+	enum intr_level old_level;
+	tid_t tid;
+
+	info = malloc(sizeof *info);
+	sa = malloc(sizeof *sa);
+	if (info == NULL || sa == NULL)
+	{
+		free(info);
+		free(sa);
+		return TID_ERROR;
+	}
+	info->parent = curr;
+	info->exit_status = -1;
+	info->refcnt = 2;
+	info->fork_ok = false;
+	sema_init(&info->forked, 0);
+	sema_init(&info->exited, 0);
+	sa->function = function;
+	sa->aux = aux;
+	sa->info = info;
+
+	tid = thread_create(name, PRI_DEFAULT, spawn_start, sa);
+	if (tid == TID_ERROR)
+	{
+		free(info);
+		free(sa);
+		return TID_ERROR;
+	}
+
+	/* 자식이 이미 종료했더라도 부모의 참조가 남아 있어 info는 살아 있다. */
+	info->tid = tid;
+	old_level = intr_disable();
+	list_push_back(&curr->child_list, &info->elem);
+	info->hash_next = child_table[tid & (CHILD_TABLE_SIZE - 1)];
+	child_table[tid & (CHILD_TABLE_SIZE - 1)] = info;
+	intr_set_level(old_level);
+
+	return tid;
+}
+
+/* process_spawn()으로 만든 스레드의 첫 함수. */
+static void
+spawn_start(void *aux)
+{
+	struct spawn_arg *sa = aux;
+	thread_func *function = sa->function;
+	void *function_aux = sa->aux;
+
+	thread_current()->child_info = sa->info;
+	free(sa);
+	function(function_aux);
+}
+
+/* 현재 스레드의 자식 중 tid가 TID인 것의 기록을 찾는다.
+ * 없거나 이미 wait했으면 NULL. */
+static struct child_info *
+get_child_process(tid_t tid)
+{
+	struct thread *curr = thread_current();
+	struct child_info *info;
+	enum intr_level old_level;
+
+	old_level = intr_disable();
+	for (info = child_table[tid & (CHILD_TABLE_SIZE - 1)]; info != NULL; info = info->hash_next)
+		if (info->tid == tid && info->parent == curr)
+			break;
+	intr_set_level(old_level);
+
+	return info;
+}
+
+/* INFO를 부모의 child_list와 child_table에서 뺀다.  인터럽트가 꺼져
+ * 있어야 한다. */
+static void
+child_info_unlink(struct child_info *info)
+{
+	struct child_info **p;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	list_remove(&info->elem);
+	for (p = &child_table[info->tid & (CHILD_TABLE_SIZE - 1)]; *p != info; p = &(*p)->hash_next)
+		ASSERT(*p != NULL);
+	*p = info->hash_next;
+}
+
+/* INFO의 참조 하나를 놓고, 마지막 참조였으면 해제한다. */
+static void
+child_info_release(struct child_info *info)
+{
+	enum intr_level old_level = intr_disable();
+	bool last = --info->refcnt == 0;
+
+	intr_set_level(old_level);
+	if (last)
+		free(info);
 }
 
 /* Free the current process's resources. */
@@ -447,14 +673,11 @@ load(const char *file_name, struct intr_frame *if_)
 	if (t->pml4 == NULL)
 		goto done;
 	process_activate(thread_current());
-	lock_acquire(&filesys_lock);
 	/* Open executable file. */
-	lock_acquire(&filesys_lock);
 	file = filesys_open(file_name);
 	if (file == NULL)
 	{
 		printf("load: %s: open failed\n", file_name);
-		lock_release(&filesys_lock);
 		goto done;
 	}
 
@@ -463,7 +686,6 @@ load(const char *file_name, struct intr_frame *if_)
 			|| ehdr.e_version != 1 || ehdr.e_phentsize != sizeof(struct Phdr) || ehdr.e_phnum > 1024)
 	{
 		printf("load: %s: error loading executable\n", file_name);
-		lock_release(&filesys_lock);
 		goto done;
 	}
 
@@ -536,7 +758,6 @@ load(const char *file_name, struct intr_frame *if_)
 
 	t->running = file;
 	file_deny_write(file); /** Project 2: Denying Writes to Executables */
-	lock_release(&filesys_lock);
 
 	/* Set up stack. */
 	if (!setup_stack(if_))
@@ -551,8 +772,6 @@ load(const char *file_name, struct intr_frame *if_)
 	success = true;
 
 done:
-	lock_release(&filesys_lock);
-
 	return success;
 }
 
@@ -768,7 +987,7 @@ load_segment(struct file *file, off_t ofs, uint8_t *upage,
 		size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
 		/* TODO: Set up aux to pass information to the lazy_load_segment. */
-		struct lazy_load_arg *lazy_load_arg = (struct lazy_load_arg *)malloc(sizeof(struct lazy_load_arg));
+		struct lazy_load_arg *lazy_load_arg = kmem_cache_alloc(&lazy_load_slab);
 		lazy_load_arg->file = file;									 // 내용이 담긴 파일 객체
 		lazy_load_arg->ofs = ofs;										 // 이 페이지에서 읽기 시작할 위치
 		lazy_load_arg->read_bytes = page_read_bytes; // 이 페이지에서 읽어야 하는 바이트 수
@@ -816,53 +1035,265 @@ setup_stack(struct intr_frame *if_)
 }
 #endif /* VM */
 
-struct thread *get_child_process(int pid)
+/* 현재 스레드가 속한 프로세스의 leader, 즉 pml4, spt, FDT를 가진
+ * 스레드를 반환한다. */
+struct thread *process_current(void)
+{
+	return thread_current()->leader;
+}
+
+/* 시스템 콜의 앞뒤와 인터럽트에서 유저 모드로 돌아가기 직전에 부른다.
+ * 프로세스가 끝나는 중이면 스레드는 유저 코드로 돌아가지 않고 여기서
+ * 끝나며, leader는 exit()를 거쳐 남은 스레드를 거둔다.  시스템 콜을 하지
+ * 않고 계산만 하는 스레드도 다음 타이머 인터럽트에서 빠져나온다.
+ *
+ * 한계: futex가 아닌 커널 대기(콘솔 read, wait, timer_sleep, 세마포어)
+ * 중인 스레드는 깨우지 않는다.  그 대기가 스스로 끝나야 여기에 닿으므로,
+ * 예를 들어 콘솔 입력을 기다리는 스레드가 있으면 uthread_reap()은 입력이
+ * 들어올 때까지 기다린다. */
+void process_check_kill(void)
 {
 	struct thread *curr = thread_current();
-	struct thread *t;
 
-	for (struct list_elem *e = list_begin(&curr->child_list); e != list_end(&curr->child_list); e = list_next(e))
-	{
-		t = list_entry(e, struct thread, child_elem);
+	if (!curr->leader->exiting)
+		return;
+	intr_enable();
+	if (curr->leader == curr)
+		exit(curr->exit_status);
+	thread_exit();
+}
 
-		if (pid == t->tid)
-			return t;
-	}
+/* process_thread_create()가 새 스레드에게 넘기는 인자. */
+struct uthread_arg
+{
+	struct thread *leader;
+	uintptr_t entry;
+	uintptr_t arg;
+	uintptr_t stack;
+	struct semaphore started; /* 새 스레드가 uthread_list에 들어가면 up */
+};
+
+/* 현재 프로세스에 유저 스레드를 만든다.  새 스레드는 주소 공간과 FDT를
+ * 공유하며, STACK을 스택 꼭대기로 삼아 유저 모드에서 ENTRY (ARG)를
+ * 실행한다.  STACK은 16바이트 정렬되어 있어야 한다.
+ * 새 스레드의 tid를 반환하고, 실패하면 TID_ERROR를 반환한다. */
+tid_t process_thread_create(void *entry, void *arg, void *stack)
+{
+	struct thread *leader = process_current();
+	struct uthread_arg ua;
+	tid_t tid;
+
+	if (leader->exiting)
+		return TID_ERROR;
+
+	ua.leader = leader;
+	ua.entry = (uintptr_t)entry;
+	ua.arg = (uintptr_t)arg;
+	ua.stack = (uintptr_t)stack;
+	sema_init(&ua.started, 0);
+
+	tid = thread_create(thread_name(), thread_get_priority(), uthread_start, &ua);
+	if (tid == TID_ERROR)
+		return TID_ERROR;
+
+	/* 유저 스레드는 wait가 아니라 join의 대상이다.  새 스레드가
+	 * 스스로 leader의 uthread_list에 들어갈 때까지 UA를 살려 둔다. */
+	sema_down(&ua.started);
 
-	return NULL;
+	return tid;
 }
 
-/* FDT 관련 함수 구현 */
-int process_add_file(struct file *f)
+/* 같은 프로세스의 유저 스레드 TID가 끝날 때까지 기다린다.
+ * 성공하면 0, TID가 없거나 이미 join되었거나 자기 자신이면 -1. */
+int process_thread_join(tid_t tid)
 {
-	struct thread *curr = thread_current();
-	struct file **fdt = curr->fd_table;
+	struct thread *leader = process_current();
+	struct thread *t = NULL;
+	enum intr_level old_level;
+	struct list_elem *e;
 
-	if (curr->fd_idx >= FDCOUNT_LIMIT)
+	if (tid == thread_tid())
 		return -1;
 
-	fdt[curr->fd_idx++] = f;
+	old_level = intr_disable();
+	for (e = list_begin(&leader->uthread_list); e != list_end(&leader->uthread_list); e = list_next(e))
+		if (list_entry(e, struct thread, uthread_elem)->tid == tid)
+		{
+			t = list_entry(e, struct thread, uthread_elem);
+			list_remove(e);
+			break;
+		}
+	intr_set_level(old_level);
 
-	return curr->fd_idx - 1;
+	if (t == NULL)
+		return -1;
+	uthread_reap(t);
+	return 0;
 }
 
-struct file *process_get_file(int fd)
+/* 유저 스레드 T가 끝나기를 기다렸다가 T가 스스로를 해제하도록 한다.
+ * T는 이미 uthread_list에서 빠져 있어야 한다. */
+static void
+uthread_reap(struct thread *t)
+{
+	sema_down(&t->wait_sema);
+	sema_up(&t->exit_sema);
+}
+
+/* 유저 스레드의 첫 커널 함수.  leader의 페이지 테이블로 옮겨 간 뒤
+ * 유저 모드로 들어간다. */
+static void
+uthread_start(void *aux)
 {
+	struct uthread_arg *ua = aux;
 	struct thread *curr = thread_current();
+	struct intr_frame if_;
+	enum intr_level old_level;
+
+	curr->leader = ua->leader;
+	curr->pml4 = ua->leader->pml4;
+	process_activate(curr);
+
+	/* join될 때까지 exit_sema에서 기다리므로 목록에 있는 동안
+	 * 이 구조체는 살아 있다. */
+	old_level = intr_disable();
+	list_push_back(&curr->leader->uthread_list, &curr->uthread_elem);
+	intr_set_level(old_level);
+
+	memset(&if_, 0, sizeof if_);
+	if_.ds = if_.es = if_.ss = SEL_UDSEG;
+	if_.cs = SEL_UCSEG;
+	if_.eflags = FLAG_IF | FLAG_MBS;
+	if_.rip = ua->entry;
+	if_.R.rdi = ua->arg;
+	if_.rsp = ua->stack - 8; /* call이 넣었을 복귀 주소 자리 */
+	sema_up(&ua->started); /* 이후로 UA는 만든 스레드의 스택에서 사라질 수 있다 */
+
+	if (curr->leader->exiting)
+		thread_exit();
+	do_iret(&if_);
+	NOT_REACHED();
+}
 
-	if (fd >= FDCOUNT_LIMIT)
-		return NULL;
+/* FDT 관련 함수 구현 */
 
-	return curr->fd_table[fd];
+/* T의 FDT를 struct thread 안의 fd_inline으로 초기화한다.
+ * 0, 1, 2번은 stdin/stdout/stderr 자리로 예약해 둔다. */
+void process_init_fdt(struct thread *t)
+{
+	t->fd_table = t->fd_inline;
+	t->fd_map = &t->fd_inline_map;
+	t->fd_cap = FD_INLINE;
+
+	t->fd_table[0] = NULL;				// stdin 예약된 자리 (dummy)
+	t->fd_table[1] = (struct file *)1; // stdout 예약된 자리 (dummy)
+	t->fd_table[2] = (struct file *)2; // stderr 예약된 자리 (dummy)
+	t->fd_inline_map = 0x7;
+	t->fd_idx = 3;
 }
 
-int process_close_file(int fd)
+/* T의 FDT를 MIN_CAP개 이상의 엔트리를 담도록 두 배씩 키운다. */
+static bool fdt_grow(struct thread *t, int min_cap)
 {
-	struct thread *curr = thread_current();
+	int cap = t->fd_cap;
+	struct file **table;
+	uint64_t *map;
 
-	if (fd >= FDCOUNT_LIMIT)
-		return -1;
+	if (min_cap > FDCOUNT_LIMIT)
+		return false;
+	while (cap < min_cap)
+		cap *= 2;
+	if (cap > FDCOUNT_LIMIT)
+		cap = FDCOUNT_LIMIT;
+
+	table = calloc(cap, sizeof *table);
+	map = calloc(DIV_ROUND_UP(cap, 64), sizeof *map);
+	if (table == NULL || map == NULL)
+	{
+		free(table);
+		free(map);
+		return false;
+	}
+	memcpy(table, t->fd_table, t->fd_cap * sizeof *table);
+	memcpy(map, t->fd_map, DIV_ROUND_UP(t->fd_cap, 64) * sizeof *map);
 
-	curr->fd_table[fd] = NULL;
-	return 0;
+	fdt_destroy(t);
+	t->fd_table = table;
+	t->fd_map = map;
+	t->fd_cap = cap;
+	return true;
+}
+
+/* T의 FDT의 FD 자리에 F를 넣는다. 필요하면 테이블을 키운다. */
+static bool fdt_install(struct thread *t, int fd, struct file *f)
+{
+	if (fd >= t->fd_cap && !fdt_grow(t, fd + 1))
+		return false;
+
+	t->fd_table[fd] = f;
+	t->fd_map[fd / 64] |= 1ULL << (fd % 64);
+	if (fd >= t->fd_idx)
+		t->fd_idx = fd + 1;
+	return true;
+}
+
+/* 따로 할당한 FDT가 있으면 해제한다. 파일은 닫지 않는다. */
+static void fdt_destroy(struct thread *t)
+{
+	if (t->fd_table != t->fd_inline)
+	{
+		free(t->fd_table);
+		free(t->fd_map);
+	}
+}
+
+/* 비어 있는 가장 작은 FD에 F를 넣고 그 번호를 반환한다.
+ * 빈 슬롯은 비트맵을 64비트 워드 단위로 훑어 찾는다. */
+int process_add_file(struct file *f)
+{
+	struct thread *curr = process_current();
+	int words, fd;
+
+	lock_acquire(&curr->fd_lock);
+	words = DIV_ROUND_UP(curr->fd_cap, 64);
+	fd = curr->fd_cap;
+	for (int i = 0; i < words; i++)
+		if (~curr->fd_map[i] != 0)
+		{
+			fd = i * 64 + __builtin_ctzll(~curr->fd_map[i]);
+			break;
+		}
+
+	if (fd >= FDCOUNT_LIMIT || !fdt_install(curr, fd, f))
+		fd = -1;
+	lock_release(&curr->fd_lock);
+	return fd;
+}
+
+struct file *process_get_file(int fd)
+{
+	struct thread *curr = process_current();
+	struct file *f = NULL;
+
+	lock_acquire(&curr->fd_lock);
+	if (fd >= 0 && fd < curr->fd_cap)
+		f = curr->fd_table[fd];
+	lock_release(&curr->fd_lock);
+	return f;
+}
+
+int process_close_file(int fd)
+{
+	struct thread *curr = process_current();
+	int result = -1;
+
+	lock_acquire(&curr->fd_lock);
+	if (fd >= 0 && fd < curr->fd_cap)
+	{
+		curr->fd_table[fd] = NULL;
+		curr->fd_map[fd / 64] &= ~(1ULL << (fd % 64));
+		result = 0;
+	}
+	lock_release(&curr->fd_lock);
+	return result;
 }
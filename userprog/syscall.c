@@ -10,11 +10,11 @@
 #include "filesys/filesys.h"
 #include "intrinsic.h"
 #include "userprog/process.h"
+#include "userprog/futex.h"
 #include "threads/palloc.h"
 #include <string.h>
 void *mmap(void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap(void *addr);
-struct lock filesys_lock;
 
 void syscall_entry(void);
 void syscall_handler(struct intr_frame *);
@@ -27,6 +27,8 @@ void close(int fd);
 int wait(tid_t pid);
 void seek(int fd, unsigned position);
 int tell(int fd);
+int futex_wait_sys(int *uaddr, int val);
+int futex_wake_sys(int *uaddr, int cnt);
 
 /* System call.
  *
@@ -50,7 +52,7 @@ void check_address(void *addr)
         exit(-1);
 
     struct thread *t = thread_current();
-    struct page *page = spt_find_page(&t->spt, addr);
+    struct page *page = spt_find_page(&process_current()->spt, addr);
 
     if (page == NULL)
     {
@@ -74,7 +76,7 @@ void *mmap(void *addr, size_t length, int writable, int fd, off_t offset)
         return NULL;
     if (!is_user_vaddr(addr) || !is_user_vaddr(addr + length))
         return NULL;
-    if (spt_find_page(&thread_current()->spt, addr)) // 얘도 문제일 수 있어
+    if (spt_find_page(&process_current()->spt, addr)) // 얘도 문제일 수 있어
         return NULL;
     if (fd <= 2) // 얘도 1로
         return NULL;
@@ -100,17 +102,21 @@ void syscall_init(void)
      * mode stack. Therefore, we masked the FLAG_FL. */
     write_msr(MSR_SYSCALL_MASK,
               FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
-    lock_init(&filesys_lock);
+    futex_init();
 }
 
 /* The main system call interface */
 void syscall_handler(struct intr_frame *f UNUSED)
 {
     int syscall_n = f->R.rax;
+    struct thread *curr = thread_current();
 #ifdef VM
-    thread_current()->rsp = f->rsp; // 💡 유저 모드 rsp 백업
+    curr->rsp = f->rsp; // 💡 유저 모드 rsp 백업
 #endif
 
+    /* 프로세스가 종료 중이면 시스템 콜을 처리하지 않고 여기서 끝낸다. */
+    process_check_kill();
+
     switch (f->R.rax)
     {
     case SYS_HALT:
@@ -161,9 +167,30 @@ void syscall_handler(struct intr_frame *f UNUSED)
     case SYS_MUNMAP:
         munmap(f->R.rdi);
         break;
+    case SYS_THREAD_CREATE:
+        f->R.rax = process_thread_create((void *)f->R.rdi, (void *)f->R.rsi,
+                                       (void *)f->R.rdx);
+        break;
+    case SYS_THREAD_EXIT:
+        if (curr->leader == curr)
+            exit(0); // 메인 스레드가 끝나면 프로세스가 끝난다.
+        thread_exit();
+        break;
+    case SYS_THREAD_JOIN:
+        f->R.rax = process_thread_join(f->R.rdi);
+        break;
+    case SYS_FUTEX_WAIT:
+        f->R.rax = futex_wait_sys((int *)f->R.rdi, f->R.rsi);
+        break;
+    case SYS_FUTEX_WAKE:
+        f->R.rax = futex_wake_sys((int *)f->R.rdi, f->R.rsi);
+        break;
     default:
         exit(-1);
     }
+
+    /* 잠들어 있던 사이에 프로세스가 종료되기 시작했을 수 있다. */
+    process_check_kill();
 }
 
 void halt(void)
@@ -174,10 +201,29 @@ void halt(void)
 void exit(int status)
 {
     struct thread *curr = thread_current();
-    curr->exit_status = status;
+    struct thread *leader = curr->leader;
+    enum intr_level old_level = intr_disable();
+
+    /* exit는 어느 스레드가 부르든 프로세스 전체를 끝낸다.
+     * 종료 상태는 가장 먼저 exit한 스레드의 것을 남긴다. */
+    if (!leader->exiting)
+    {
+        leader->exit_status = status;
+        leader->exiting = true;
+    }
+    intr_set_level(old_level);
+
+    /* 정리는 자원을 가진 leader가 맡는다.  futex에서 자는 leader를
+     * 깨우고, 유저 모드의 leader는 다음 인터럽트나 시스템 콜에서
+     * process_check_kill()을 거쳐 이곳으로 다시 들어온다. */
+    if (curr != leader)
+    {
+        futex_wake_all(leader);
+        thread_exit();
+    }
 
     // Print termination message
-    printf("%s: exit(%d)\n", thread_name(), status);
+    printf("%s: exit(%d)\n", thread_name(), leader->exit_status);
 
     thread_exit();
 }
@@ -185,21 +231,16 @@ void exit(int status)
 int write(int fd, const void *buffer, unsigned size)
 {
     check_address(buffer);
-    lock_acquire(&filesys_lock);
 
     off_t bytes = -1;
 
     if (fd <= 0) // stdin에 쓰려고 할 경우 & fd 음수일 경우
     {
-        lock_release(&filesys_lock);
-
         return -1;
     }
 
     if (fd < 3)
     { // 1(stdout) * 2(stderr) -> console로 출력
-        lock_release(&filesys_lock);
-
         putbuf(buffer, size);
         return size;
     }
@@ -208,13 +249,10 @@ int write(int fd, const void *buffer, unsigned size)
 
     if (file == NULL)
     {
-        lock_release(&filesys_lock);
-
         return -1;
     }
 
     bytes = file_write(file, buffer, size);
-    lock_release(&filesys_lock);
 
     return bytes;
 }
@@ -222,30 +260,24 @@ int write(int fd, const void *buffer, unsigned size)
 bool create(const char *file, unsigned initial_size)
 {
     check_address(file);
-    lock_acquire(&filesys_lock);
     bool success = filesys_create(file, initial_size);
-    lock_release(&filesys_lock);
     return success;
 }
 
 bool remove(const char *file)
 {
     check_address(file);
-    lock_acquire(&filesys_lock);
     bool is_success = filesys_remove(file);
-    lock_release(&filesys_lock);
     return is_success;
 }
 
 int open(const char *file)
 {
     check_address(file);
-    lock_acquire(&filesys_lock);
     struct file *newfile = filesys_open(file);
 
     if (newfile == NULL)
     {
-        lock_release(&filesys_lock);
         return -1;
     }
 
@@ -253,10 +285,8 @@ int open(const char *file)
 
     if (fd == -1)
     {
-
         file_close(newfile);
     }
-    lock_release(&filesys_lock);
 
     return fd;
 }
@@ -269,7 +299,6 @@ tid_t fork(const char *thread_name, struct intr_frame *f)
 int read(int fd, void *buffer, unsigned size)
 {
     check_address(buffer);
-    lock_acquire(&filesys_lock);
     if (fd == 0)
     {              // 0(stdin) -> keyboard로 직접 입력
         int i = 0; // 쓰레기 값 return 방지
@@ -283,13 +312,11 @@ int read(int fd, void *buffer, unsigned size)
             if (c == '\0')
                 break;
         }
-        lock_release(&filesys_lock);
         return i;
     }
     // 그 외의 경우
     if (fd < 3) // stdout, stderr를 읽으려고 할 경우 & fd가 음수일 경우
     {
-        lock_release(&filesys_lock);
         return -1;
     }
 
@@ -298,20 +325,17 @@ int read(int fd, void *buffer, unsigned size)
 
     if (file == NULL) // 파일이 비어있을 경우
     {
-        lock_release(&filesys_lock);
         return -1;
     }
 
 #ifdef VM
-    struct page *page = spt_find_page(&thread_current()->spt, buffer);
+    struct page *page = spt_find_page(&process_current()->spt, buffer);
     if (page && !page->writable)
     {
-        lock_release(&filesys_lock);
         exit(-1);
     }
 #endif
     bytes = file_read(file, buffer, size);
-    lock_release(&filesys_lock);
 
     return bytes;
 }
@@ -323,15 +347,18 @@ int filesize(int fd)
     if (file == NULL)
         return -1;
 
-    lock_acquire(&filesys_lock);
     int length = file_length(file);
-    lock_release(&filesys_lock);
     return length;
 }
 int exec(const char *file_name)
 {
     check_address(file_name);
 
+    /* 다른 스레드가 주소 공간을 쓰고 있으면 exec할 수 없다. */
+    struct thread *curr = thread_current();
+    if (curr->leader != curr || !list_empty(&curr->uthread_list))
+        return -1;
+
     off_t size = strlen(file_name) + 1;
     char *cmd_copy = palloc_get_page(PAL_ZERO);
 
@@ -353,9 +380,7 @@ void seek(int fd, unsigned position)
     if (fd < 3 || file == NULL)
         return;
 
-    lock_acquire(&filesys_lock);
     file_seek(file, position);
-    lock_release(&filesys_lock);
 }
 
 // fd에서 다음에 읽거나 쓸 바이트의 위치를 반환하는 함수
@@ -365,9 +390,7 @@ int tell(int fd)
     if (fd < 3 || file == NULL)
         return -1;
 
-    lock_acquire(&filesys_lock);
     int pos = file_tell(file);
-    lock_release(&filesys_lock);
     return pos;
 }
 
@@ -388,4 +411,24 @@ void close(int fd)
 int wait(tid_t pid)
 {
     return process_wait(pid);
-}
\ No newline at end of file
+}
+
+// futex 주소 UADDR의 값이 VAL인 동안 잠든다.
+int futex_wait_sys(int *uaddr, int val)
+{
+    check_address(uaddr);
+    if ((uintptr_t)uaddr % sizeof(int) != 0)
+        return -1;
+
+    return futex_wait(uaddr, val);
+}
+
+// futex 주소 UADDR에서 잠든 스레드를 최대 CNT개 깨운다.
+int futex_wake_sys(int *uaddr, int cnt)
+{
+    check_address(uaddr);
+    if ((uintptr_t)uaddr % sizeof(int) != 0)
+        return -1;
+
+    return futex_wake(uaddr, cnt);
+}
@@ -112,7 +112,7 @@ anon_destroy(struct page *page)
 	{
 		list_remove(&page->frame->elem);
 		page->frame->page = NULL;
-		free(page->frame);
+		kmem_cache_free(&frame_slab, page->frame);
 		page->frame = NULL;
 	}
 }
@@ -115,9 +115,7 @@ do_mmap(void *addr, size_t length, int writable,
 	// TODO: 2. fd에 대응하는 struct file * 구하기
 	// - 열린 파일 디스크립터 테이블에서 찾고, 실패 시 NULL 반환
 	// - file을 reopen하여 별도 참조를 유지 (중복 닫힘 방지)
-	lock_acquire(&filesys_lock);
 	struct file *f = file_reopen(file);
-	lock_release(&filesys_lock);
 
 	if (file == NULL)
 	{
@@ -151,6 +149,8 @@ do_mmap(void *addr, size_t length, int writable,
 	// TODO: 5. 모든 페이지가 성공적으로 매핑되었으면 addr 반환
 	// - 실패 시 중간에 등록한 페이지들을 모두 해제하고 NULL 반환
 	int mapped_pages = 0;
+	struct supplemental_page_table *spt = &process_current()->spt;
+	bool locked = spt_lock(spt); /* 매핑 전체를 한 번에 등록하거나 되돌린다 */
 
 	while (read_bytes > 0 || zero_bytes > 0)
 	{
@@ -161,25 +161,26 @@ do_mmap(void *addr, size_t length, int writable,
 		size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
 		/* TODO: Set up aux to pass information to the lazy_load_segment. */
-		struct lazy_load_arg *lazy_load_arg = (struct lazy_load_arg *)malloc(sizeof(struct lazy_load_arg));
+		struct lazy_load_arg *lazy_load_arg = kmem_cache_alloc(&lazy_load_slab);
 		lazy_load_arg->file = f;										 // 내용이 담긴 파일 객체
 		lazy_load_arg->ofs = offset;								 // 이 페이지에서 읽기 시작할 위치
 		lazy_load_arg->read_bytes = page_read_bytes; // 이 페이지에서 읽어야 하는 바이트 수
 		lazy_load_arg->zero_bytes = page_zero_bytes; // 이 페이지에서 read_bytes만큼 읽고 공간이 남아 0으로 채워야 하는 바이트 수
 		if (!vm_alloc_page_with_initializer(VM_FILE, addr, writable, lazy_load_segment, lazy_load_arg))
 		{
-			free(lazy_load_arg);
+			kmem_cache_free(&lazy_load_slab, lazy_load_arg);
 			for (int i = 0; i < mapped_pages; i++)
 			{
 				void *rollback_addr = start_addr + i * PGSIZE;
-				struct page *rollback_page = spt_find_page(&thread_current()->spt, rollback_addr);
+				struct page *rollback_page = spt_find_page(spt, rollback_addr);
 				if (rollback_page)
-					spt_remove_page(&thread_current()->spt, rollback_page);
+					spt_remove_page(spt, rollback_page);
 			}
+			spt_unlock(spt, locked);
 			return NULL;
 		}
 		mapped_pages++;
-		struct page *p = spt_find_page(&thread_current()->spt, start_addr);
+		struct page *p = spt_find_page(spt, start_addr);
 		p->mapped_page_count = total_page_count;
 
 		/* Advance. */
@@ -188,15 +189,17 @@ do_mmap(void *addr, size_t length, int writable,
 		addr += PGSIZE;
 		offset += page_read_bytes;
 	}
+	spt_unlock(spt, locked);
 	return start_addr;
 }
 
 /* Do the munmap */
 void do_munmap(void *addr)
 {
-	struct supplemental_page_table *spt = &thread_current()->spt;
+	struct supplemental_page_table *spt = &process_current()->spt;
+	bool locked = spt_lock(spt);
 	struct page *p = spt_find_page(spt, addr);
-	int count = p->mapped_page_count;
+	int count = p != NULL ? p->mapped_page_count : 0;
 	for (int i = 0; i < count; i++)
 	{
 		if (p)
@@ -204,4 +207,5 @@ void do_munmap(void *addr)
 		addr += PGSIZE;
 		p = spt_find_page(spt, addr);
 	}
+	spt_unlock(spt, locked);
 }
\ No newline at end of file
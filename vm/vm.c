@@ -13,6 +13,12 @@
 #include "threads/vaddr.h"
 static struct lock frame_table_lock;
 struct lock frame_lock;
+
+/* 자주 할당하는 VM 구조체는 malloc의 2의 거듭제곱 크기 대신
+   정확한 크기의 slab 캐시에서 받는다. */
+struct kmem_cache page_slab;
+struct kmem_cache frame_slab;
+struct kmem_cache lazy_load_slab;
 struct list_elem *next = NULL;
 /* 각 서브시스템의 초기화 코드를 호출하여 가상 메모리 서브시스템을 초기화합니다. */
 void vm_init(void)
@@ -26,6 +32,10 @@ void vm_init(void)
 	/* 이 위쪽은 수정하지 마세요 !! */
 	/* TODO: 이 아래쪽부터 코드를 추가하세요 */
 	list_init(&frame_table); /* 25.05.30 고재웅 작성 */
+	kmem_cache_create(&page_slab, "page", sizeof(struct page), NULL);
+	kmem_cache_create(&frame_slab, "frame", sizeof(struct frame), NULL);
+	kmem_cache_create(&lazy_load_slab, "lazy_load_arg",
+										sizeof(struct lazy_load_arg), NULL);
 	lock_init(&frame_table_lock);
 	lock_init(&frame_lock);
 }
@@ -58,6 +68,25 @@ static struct frame *vm_evict_frame(void);
 void supplemental_page_table_init(struct supplemental_page_table *spt)
 {
 	hash_init(&spt->pages, page_hash, page_less, NULL);
+	lock_init(&spt->lock);
+}
+
+/* SPT의 락을 잡는다. 폴트 처리 중 스택 확장이나 do_mmap처럼 이미 락을
+ * 잡은 채로 다시 들어오는 경로가 있으므로, 현재 스레드가 이미 잡고 있으면
+ * 아무것도 하지 않고 false를 돌려준다. 돌려받은 값은 spt_unlock()에 넘긴다. */
+bool spt_lock(struct supplemental_page_table *spt)
+{
+	if (lock_held_by_current_thread(&spt->lock))
+		return false;
+	lock_acquire(&spt->lock);
+	return true;
+}
+
+/* spt_lock()이 실제로 잡은 경우에만 락을 놓는다. */
+void spt_unlock(struct supplemental_page_table *spt, bool locked)
+{
+	if (locked)
+		lock_release(&spt->lock);
 }
 bool vm_alloc_page_with_initializer(enum vm_type type, void *upage, bool writable,
 																		vm_initializer *init, void *aux)
@@ -65,7 +94,9 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage, bool writabl
 
 	ASSERT(VM_TYPE(type) != VM_UNINIT)
 
-	struct supplemental_page_table *spt = &thread_current()->spt;
+	struct supplemental_page_table *spt = &process_current()->spt;
+	bool locked = spt_lock(spt);
+	bool success = false;
 
 	/* Check wheter the upage is already occupied or not. */
 	if (spt_find_page(spt, upage) == NULL)
@@ -73,12 +104,10 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage, bool writabl
 		/* TODO: 페이지를 생성하고, VM 유형에 따라 초기화 파일을 가져옵니다.Add commentMore actions
 		 * TODO: 그런 다음 uninit_new를 호출하여 "uninit" 페이지 구조체를 생성합니다.
 		 * TODO: uninit_new를 호출한 후 필드를 수정해야 합니다. */
-		struct page *p = (struct page *)malloc(sizeof(struct page));
+		struct page *p = kmem_cache_alloc(&page_slab);
 
 		if (p == NULL)
-		{
-			return false;
-		}
+			goto err;
 
 		bool (*page_initializer)(struct page *, enum vm_type, void *);
 
@@ -91,18 +120,19 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage, bool writabl
 			page_initializer = file_backed_initializer;
 			break;
 		default:
-			free(p);
-			return false;
+			kmem_cache_free(&page_slab, p);
+			goto err;
 		}
 
 		/* TODO: spt에 페이지를 삽입합니다. */
 		uninit_new(p, upage, init, type, aux, page_initializer);
 		p->writable = writable;
 
-		return spt_insert_page(spt, p);
+		success = spt_insert_page(spt, p);
 	}
 err:
-	return false;
+	spt_unlock(spt, locked);
+	return success;
 }
 
 /* 25.05.30 고재웅 작성
@@ -204,7 +234,7 @@ vm_get_frame(void)
 		return vm_evict_frame(); // 페이지 교체 전략 필요
 
 	// 프레임 구조체 할당
-	struct frame *frame = (struct frame *)malloc(sizeof(struct frame));
+	struct frame *frame = kmem_cache_alloc(&frame_slab);
 	ASSERT(frame != NULL);
 
 	frame->kva = kva;
@@ -250,8 +280,9 @@ bool is_stack_access(void *addr, void *rsp)
 bool vm_try_handle_fault(struct intr_frame *f, void *addr,
 												 bool user, bool write, bool not_present)
 {
-	struct supplemental_page_table *spt = &thread_current()->spt;
+	struct supplemental_page_table *spt = &process_current()->spt;
 	struct page *page = NULL;
+	bool success = false;
 
 	// 1. 주소 유효성 검사
 	if (addr == NULL || is_kernel_vaddr(addr))
@@ -260,6 +291,10 @@ bool vm_try_handle_fault(struct intr_frame *f, void *addr,
 	// 2. page가 존재하지 않은 경우 (not-present fault)
 	if (not_present)
 	{
+		/* 같은 프로세스의 다른 스레드가 같은 페이지에서 동시에 폴트를
+		 * 낼 수 있으므로 찾기부터 매핑까지 SPT 락 안에서 한다. */
+		bool locked = spt_lock(spt);
+
 		// 📌 스택 확장 여부 판단
 		void *rsp = user ? f->rsp : thread_current()->rsp;
 
@@ -270,16 +305,15 @@ bool vm_try_handle_fault(struct intr_frame *f, void *addr,
 
 		// 3. SPT에서 페이지 찾기 → 위에서 stack_growth 했으면 있을 수도 있음
 		page = spt_find_page(spt, addr);
-		if (page == NULL)
-			return false;
-
-		if (write && !page->writable)
-			return false;
-
-		return vm_do_claim_page(page);
+		if (page != NULL && !(write && !page->writable))
+		{
+			/* 락을 기다리는 동안 다른 스레드가 이미 올려 놓았으면 끝 */
+			success = page->frame != NULL || vm_do_claim_page(page);
+		}
+		spt_unlock(spt, locked);
 	}
 
-	return false;
+	return success;
 }
 
 /* Free the page.
@@ -287,7 +321,7 @@ bool vm_try_handle_fault(struct intr_frame *f, void *addr,
 void vm_dealloc_page(struct page *page)
 {
 	destroy(page);
-	free(page);
+	kmem_cache_free(&page_slab, page);
 }
 
 /* 25.06.01 고재웅 수정
@@ -296,21 +330,26 @@ void vm_dealloc_page(struct page *page)
 bool vm_claim_page(void *va UNUSED)
 {
 	/* TODO: Fill this function */
+	struct supplemental_page_table *spt = &process_current()->spt;
+	bool locked = spt_lock(spt);
 	struct page *page = NULL;
-	page = spt_find_page(&thread_current()->spt, va);
-	if (page == NULL)
-	{
-		return false;
-	}
-	return vm_do_claim_page(page);
+	bool success = false;
+
+	page = spt_find_page(spt, va);
+	if (page != NULL)
+		success = page->frame != NULL || vm_do_claim_page(page);
+	spt_unlock(spt, locked);
+	return success;
 }
 
 /* 25.06.01 고재웅 수정
  * 인자로 주어진 page에 frame을 할당 한다. --> vm_get_frame()
- * mmu를 설정한다.(pml4) */
+ * mmu를 설정한다.(pml4). pml4를 바꾸므로 SPT 락을 잡은 채로 부른다. */
 static bool
 vm_do_claim_page(struct page *page)
 {
+	ASSERT(lock_held_by_current_thread(&process_current()->spt.lock));
+
 	struct frame *frame = vm_get_frame();
 	/* TODO: vm_get_frame이 실패하면 swap_out */
 
@@ -337,6 +376,11 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED,
 																	struct supplemental_page_table *src UNUSED)
 {
 	struct hash_iterator iter;
+	bool success = true;
+
+	/* src는 부모 프로세스의 SPT라 부모의 다른 스레드가 동시에 바꿀 수 있다.
+	 * dst의 락은 아래 vm_alloc_page/vm_claim_page가 잡는다. */
+	lock_acquire(&src->lock);
 	hash_first(&iter, &src->pages);
 
 	while (hash_next(&iter))
@@ -361,26 +405,28 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED,
 
 			if (!vm_alloc_page_with_initializer(real_type, upage, writable,
 																					src_page->uninit.init, aux))
-				return false;
+			{
+				success = false;
+				break;
+			}
 		}
 		/* Loaded page (e.g., ANON) */
 		else
 		{
-			if (!vm_alloc_page(type, upage, writable))
-				return false;
-
-			if (!vm_claim_page(upage))
-				return false;
-
-			struct page *dst_page = spt_find_page(dst, upage);
-			if (!dst_page)
-				return false;
+			struct page *dst_page;
+			if (!vm_alloc_page(type, upage, writable) || !vm_claim_page(upage) ||
+					(dst_page = spt_find_page(dst, upage)) == NULL)
+			{
+				success = false;
+				break;
+			}
 
 			memcpy(dst_page->frame->kva, src_page->frame->kva, PGSIZE);
 		}
 	}
+	lock_release(&src->lock);
 
-	return true;
+	return success;
 }
 
 /* Free the resource hold by the supplemental page table */
@@ -414,5 +460,5 @@ void hash_page_destroy(struct hash_elem *e, void *aux)
 {
 	struct page *page = hash_entry(e, struct page, hash_elem);
 	destroy(page);
-	free(page);
+	kmem_cache_free(&page_slab, page);
 }
\ No newline at end of file